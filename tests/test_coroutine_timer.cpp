@@ -0,0 +1,149 @@
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <coroutine>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "timestorm/coroutine_timer.h"
+
+// Minimal eager coroutine type, enough to drive the timer from tests.
+struct task {
+  struct promise_type {
+    task get_return_object() {
+      return {std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_never initial_suspend() noexcept {return {};}
+    std::suspend_always final_suspend() noexcept {return {};}
+    void return_void() {}
+    void unhandled_exception() {throw;}
+  };
+  std::coroutine_handle<promise_type> handle;
+
+  ~task() {
+    if(handle) {
+      handle.destroy();
+    }
+  }
+};
+
+// Awaiter that stays suspended until the test resumes it by hand.
+struct manual_event {
+  std::coroutine_handle<> waiting;
+
+  bool await_ready() {return false;}
+  void await_suspend(std::coroutine_handle<> handle) {waiting = handle;}
+  int await_resume() {return 42;}
+};
+
+// Awaiter whose bool await_suspend declines to suspend.
+struct declining_awaiter {
+  bool await_ready() {return false;}
+  bool await_suspend(std::coroutine_handle<>) {return false;}
+  void await_resume() {}
+};
+
+// Awaitable reached through a member operator co_await.
+struct ready_awaitable {
+  std::suspend_never operator co_await() {return {};}
+};
+
+struct coroutine_result {
+  std::chrono::nanoseconds active{0};
+  std::chrono::nanoseconds suspended{0};
+  unsigned int suspensions{0};
+  int value{0};
+};
+
+// ─────────────────────────────────────────────────────────────────────────────
+// coroutine_timer
+// ─────────────────────────────────────────────────────────────────────────────
+
+task wait_twice(manual_event &event, coroutine_result &result, std::ostream &out) {
+  timestorm::coroutine_timer<float> t(out, "", "");
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));                   // active work
+  result.value = co_await t.wrap(event);
+  co_await t.wrap(event);
+  result.active      = t.get_active_duration();
+  result.suspended   = t.get_suspended_duration();
+  result.suspensions = t.get_suspensions();
+}
+
+TEST_CASE("coroutine_timer separates suspended time from active time", "[coroutine_timer]") {
+  std::ostringstream oss;
+  manual_event event;
+  coroutine_result result;
+  task const t{wait_twice(event, result, oss)};
+  for(int i{0}; i != 2; ++i) {
+    REQUIRE(event.waiting);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));                 // suspended time
+    auto const waiting{event.waiting};
+    event.waiting = nullptr;
+    waiting.resume();
+  }
+  REQUIRE(t.handle.done());
+  CHECK(result.value == 42);
+  CHECK(result.suspensions == 2);
+  CHECK(result.suspended >= std::chrono::milliseconds(60));
+  CHECK(result.active    >= std::chrono::milliseconds(10));
+  CHECK(result.active    <  std::chrono::milliseconds(60));
+  std::string const out{oss.str()};
+  CHECK(out.find(" active, ") != std::string::npos);
+  CHECK(out.find(" suspended, 2 suspensions") != std::string::npos);
+}
+
+task no_suspension(coroutine_result &result, std::ostream &out) {
+  timestorm::coroutine_timer<float> t(out);
+  co_await t.wrap(declining_awaiter{});
+  co_await t.wrap(ready_awaitable{});
+  co_await t.wrap(std::suspend_never{});
+  result.suspended   = t.get_suspended_duration();
+  result.suspensions = t.get_suspensions();
+}
+
+TEST_CASE("coroutine_timer counts nothing when the awaitable does not suspend", "[coroutine_timer]") {
+  std::ostringstream oss;
+  coroutine_result result;
+  task const t{no_suspension(result, oss)};
+  REQUIRE(t.handle.done());
+  CHECK(result.suspensions == 0);
+  CHECK(result.suspended == std::chrono::nanoseconds{0});
+}
+
+TEST_CASE("coroutine_timer pause() and resume() can be used by hand", "[coroutine_timer]") {
+  std::ostringstream oss;
+  timestorm::coroutine_timer<float> t(static_cast<std::ostream&>(oss), timestorm::timescale::MILLISECONDS, "X", "Y");
+  t.pause();
+  t.pause();                                                                    // pausing twice is one suspension
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  t.resume();
+  CHECK(t.get_suspensions() == 1);
+  CHECK(t.get_suspended_duration() >= std::chrono::milliseconds(20));
+  t.output();
+  std::string const out{oss.str()};
+  CHECK(out.rfind("X", 0) == 0);
+  CHECK(out.find("ms suspended, 1 suspensionY") != std::string::npos);
+}
+
+TEST_CASE("coroutine_timer reset() clears times and suspensions", "[coroutine_timer]") {
+  std::ostringstream oss;
+  timestorm::coroutine_timer<float> t(static_cast<std::ostream&>(oss), "", "");
+  t.pause();
+  t.resume();
+  t.reset();
+  CHECK(t.get_suspensions() == 0);
+  CHECK(t.get_suspended_duration() == std::chrono::nanoseconds{0});
+}
+
+TEST_CASE("coroutine_timer reset() while paused keeps the suspension going", "[coroutine_timer]") {
+  std::ostringstream oss;
+  timestorm::coroutine_timer<float> t(static_cast<std::ostream&>(oss), timestorm::timescale::MILLISECONDS, "", "");
+  t.pause();
+  t.reset();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  t.resume();
+  CHECK(t.get_suspensions() == 1);
+  CHECK(t.get_suspended_duration() >= std::chrono::milliseconds(20));
+  CHECK(t.get_active_duration() < std::chrono::milliseconds(20));
+  t.output();
+  CHECK(oss.str().find("ms suspended, 1 suspension") != std::string::npos);
+}
@@ -0,0 +1,111 @@
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "timestorm/timestorm.h"
+
+// ─────────────────────────────────────────────────────────────────────────────
+// timescale helpers
+// ─────────────────────────────────────────────────────────────────────────────
+
+TEST_CASE("auto_timescale picks the largest unit below the duration", "[timescale][auto]") {
+  using namespace std::chrono_literals;
+  CHECK(timestorm::auto_timescale(500ns) == timestorm::timescale::NANOSECONDS);
+  CHECK(timestorm::auto_timescale(5us)   == timestorm::timescale::MICROSECONDS);
+  CHECK(timestorm::auto_timescale(5ms)   == timestorm::timescale::MILLISECONDS);
+  CHECK(timestorm::auto_timescale(5s)    == timestorm::timescale::SECONDS);
+  CHECK(timestorm::auto_timescale(5min)  == timestorm::timescale::SECONDS);     // seconds up to 1000s
+  CHECK(timestorm::auto_timescale(30min) == timestorm::timescale::MINUTES);
+  CHECK(timestorm::auto_timescale(5h)    == timestorm::timescale::HOURS);
+  CHECK(timestorm::auto_timescale(50h)   == timestorm::timescale::DAYS);
+}
+
+TEST_CASE("scale_duration converts to the requested unit", "[timescale]") {
+  using namespace std::chrono_literals;
+  CHECK(timestorm::scale_duration<double>(1500us, timestorm::timescale::MILLISECONDS) == 1.5);
+  CHECK(timestorm::scale_duration<double>(90s,    timestorm::timescale::MINUTES)      == 1.5);
+  CHECK(timestorm::scale_duration<double>(1500us, timestorm::timescale::AUTO)         == 1.5);
+  CHECK(std::string(timestorm::timescale_unit(timestorm::timescale::MILLISECONDS)) == "ms");
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// phase_timer
+// ─────────────────────────────────────────────────────────────────────────────
+
+TEST_CASE("phase_timer reports each phase and the total on one line", "[phase_timer][output]") {
+  std::ostringstream oss;
+  {
+    timestorm::phase_timer<float> t(static_cast<std::ostream&>(oss), "Request: ", "\n");
+    t.split("parse");
+    t.split("plan");
+    t.split("exec");
+  }
+  std::string const out{oss.str()};
+  CHECK(out.rfind("Request: parse ", 0) == 0);
+  CHECK(out.find(", plan ")  != std::string::npos);
+  CHECK(out.find(", exec ")  != std::string::npos);
+  CHECK(out.find(", total ") != std::string::npos);
+  CHECK(out.find('\n') == out.size() - 1);
+}
+
+TEST_CASE("phase_timer with no splits reports only the total", "[phase_timer][output]") {
+  std::ostringstream oss;
+  {
+    timestorm::phase_timer<float> t(static_cast<std::ostream&>(oss), timestorm::timescale::NANOSECONDS, "", ".");
+  }
+  std::string const out{oss.str()};
+  CHECK(out.rfind("total ", 0) == 0);
+  CHECK(out.find("ns.") != std::string::npos);
+}
+
+TEST_CASE("phase_timer phase durations add up to the time of the last split", "[phase_timer][get_time]") {
+  std::ostringstream oss;
+  timestorm::phase_timer<float> t(static_cast<std::ostream&>(oss));
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  t.split("first");
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  t.split("second");
+  REQUIRE(t.get_phase_count() == 2);
+  CHECK(t.get_phase_duration(0) >= std::chrono::milliseconds(10));
+  CHECK(t.get_phase_duration(1) >= std::chrono::milliseconds(20));
+  CHECK(t.get_total_duration() >= t.get_phase_duration(0) + t.get_phase_duration(1));
+}
+
+TEST_CASE("phase_timer uses AUTO units per phase", "[phase_timer][auto]") {
+  std::ostringstream oss;
+  {
+    timestorm::phase_timer<float> t(static_cast<std::ostream&>(oss), "", "");
+    t.split("quick");
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    t.split("slow");
+  }
+  std::string const out{oss.str()};
+  CHECK(out.find("ms, total") != std::string::npos);                           // the slow phase is reported in milliseconds
+}
+
+TEST_CASE("phase_timer extends the last phase once all phases are used", "[phase_timer][split]") {
+  std::ostringstream oss;
+  timestorm::phase_timer<float, std::ostream, 2> t(static_cast<std::ostream&>(oss), "", "");
+  t.split("a");
+  t.split("b");
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  t.split("c");
+  t.split("d");
+  CHECK(t.get_phase_count() == 2);
+  CHECK(t.get_phases_merged() == 2);
+  CHECK(t.get_phase_duration(1) >= std::chrono::milliseconds(5));
+  t.output();
+  CHECK(oss.str().find("b +2 more ") != std::string::npos);                     // the extra time is not passed off as b's alone
+
+  t.reset();
+  CHECK(t.get_phases_merged() == 0);
+}
+
+TEST_CASE("phase_timer reset() discards phases", "[phase_timer][reset]") {
+  std::ostringstream oss;
+  timestorm::phase_timer<float> t(static_cast<std::ostream&>(oss), "", "");
+  t.split("discarded");
+  t.reset();
+  CHECK(t.get_phase_count() == 0);
+}
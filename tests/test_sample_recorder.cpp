@@ -0,0 +1,188 @@
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "timestorm/sample_recorder.h"
+
+// Relative comparison for floating point statistics.
+static bool approximately_equal(double value, double expected) {
+  return std::abs(value - expected) <= 1e-9 * std::max(1.0, std::abs(expected));
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Recording
+// ─────────────────────────────────────────────────────────────────────────────
+
+TEST_CASE("sample_recorder add_site returns the same index for the same name", "[sample_recorder][site]") {
+  timestorm::sample_recorder recorder;
+  unsigned int const parse{recorder.add_site("parse")};
+  unsigned int const plan{recorder.add_site("plan")};
+  CHECK(parse != plan);
+  CHECK(recorder.add_site("parse") == parse);
+  CHECK(recorder.get_site_count() == 2);
+  CHECK(recorder.get_site_name(plan) == "plan");
+}
+
+TEST_CASE("samples are kept in recorded order across chunks", "[sample_recorder][record]") {
+  timestorm::sample_recorder recorder;
+  unsigned int const site{recorder.add_site("work")};
+  size_t const total{timestorm::sample_recorder::chunk_samples * 2 + 5};
+  for(size_t i{0}; i != total; ++i) {
+    recorder.record(site, static_cast<int64_t>(i));
+  }
+  REQUIRE(recorder.get_sample_count(site) == total);
+  int64_t expected{0};
+  size_t chunks{0};
+  bool in_order{true};
+  recorder.for_each_chunk(site, [&](std::span<int64_t const> chunk){
+    ++chunks;
+    for(int64_t const sample : chunk) {
+      in_order = in_order && sample == expected++;
+    }
+  });
+  CHECK(chunks == 3);
+  CHECK(in_order);
+}
+
+TEST_CASE("samples beyond the budget are dropped", "[sample_recorder][record]") {
+  timestorm::sample_recorder recorder(timestorm::sample_recorder::chunk_samples);
+  unsigned int const site{recorder.add_site("bounded")};
+  for(size_t i{0}; i != timestorm::sample_recorder::chunk_samples + 10; ++i) {
+    recorder.record(site, int64_t{1});
+  }
+  CHECK(recorder.get_sample_count(site) == timestorm::sample_recorder::chunk_samples);
+  CHECK(recorder.get_dropped() == 10);
+
+  recorder.clear();
+  CHECK(recorder.get_sample_count(site) == 0);
+  CHECK(recorder.get_dropped() == 0);
+}
+
+TEST_CASE("sample_recorder scope records its lifetime", "[sample_recorder][scope]") {
+  timestorm::sample_recorder recorder;
+  unsigned int const site{recorder.add_site("sleep")};
+  {
+    timestorm::sample_recorder::scope s(recorder, site);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  REQUIRE(recorder.get_sample_count(site) == 1);
+  CHECK(recorder.get_stats(site).min >= 5'000'000);
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Statistics
+// ─────────────────────────────────────────────────────────────────────────────
+
+TEST_CASE("get_stats computes min, max, mean and variance", "[sample_recorder][stats]") {
+  timestorm::sample_recorder recorder;
+  unsigned int const site{recorder.add_site("known")};
+  for(int64_t const sample : {2, 4, 4, 4, 5, 5, 7, 9, 1, 9, 8}) {              // odd length exercises the remainder lanes
+    recorder.record(site, sample);
+  }
+  auto const stats{recorder.get_stats(site)};
+  CHECK(stats.count == 11);
+  CHECK(stats.min == 1);
+  CHECK(stats.max == 9);
+  CHECK(approximately_equal(stats.mean, 58.0 / 11.0));
+  double expected_variance{0.0};
+  for(int64_t const sample : {2, 4, 4, 4, 5, 5, 7, 9, 1, 9, 8}) {
+    expected_variance += (sample - 58.0 / 11.0) * (sample - 58.0 / 11.0);
+  }
+  CHECK(approximately_equal(stats.variance, expected_variance / 11.0));
+}
+
+TEST_CASE("get_stats is empty for a site with no samples", "[sample_recorder][stats]") {
+  timestorm::sample_recorder recorder;
+  auto const stats{recorder.get_stats(recorder.add_site("empty"))};
+  CHECK(stats.count == 0);
+  CHECK(stats.mean == 0.0);
+}
+
+TEST_CASE("merged stats match stats over the combined samples", "[sample_recorder][stats]") {
+  timestorm::sample_recorder first;
+  timestorm::sample_recorder second;
+  timestorm::sample_recorder both;
+  unsigned int const a{first.add_site("x")};
+  unsigned int const b{second.add_site("x")};
+  unsigned int const c{both.add_site("x")};
+  for(int64_t i{0}; i != 1000; ++i) {
+    first.record(a, i * 3);
+    both.record(c, i * 3);
+  }
+  for(int64_t i{0}; i != 300; ++i) {
+    second.record(b, 5000 + i);
+    both.record(c, 5000 + i);
+  }
+  auto merged{first.get_stats(a)};
+  merged.merge(second.get_stats(b));
+  auto const expected{both.get_stats(c)};
+  CHECK(merged.count == expected.count);
+  CHECK(merged.min   == expected.min);
+  CHECK(merged.max   == expected.max);
+  CHECK(approximately_equal(merged.mean, expected.mean));
+  CHECK(approximately_equal(merged.variance, expected.variance));
+}
+
+TEST_CASE("get_stats handles samples too large to sum exactly", "[sample_recorder][stats]") {
+  timestorm::sample_recorder recorder;
+  unsigned int const site{recorder.add_site("extreme")};
+  int64_t const largest{std::numeric_limits<int64_t>::max()};
+  for(int i{0}; i != 10; ++i) {                                                 // would overflow an int64_t sum
+    recorder.record(site, largest);
+  }
+  auto const stats{recorder.get_stats(site)};
+  CHECK(stats.count == 10);
+  CHECK(stats.min == largest);
+  CHECK(stats.max == largest);
+  CHECK(approximately_equal(stats.mean, static_cast<double>(largest)));
+
+  unsigned int const mixed{recorder.add_site("mixed")};
+  recorder.record(mixed, std::numeric_limits<int64_t>::min());
+  recorder.record(mixed, int64_t{0});
+  auto const mixed_stats{recorder.get_stats(mixed)};
+  CHECK(mixed_stats.min == std::numeric_limits<int64_t>::min());
+  CHECK(mixed_stats.max == 0);
+  CHECK(approximately_equal(mixed_stats.mean, static_cast<double>(std::numeric_limits<int64_t>::min()) / 2.0));
+}
+
+TEST_CASE("get_percentiles selects exact order statistics", "[sample_recorder][percentile]") {
+  timestorm::sample_recorder recorder;
+  unsigned int const site{recorder.add_site("uniform")};
+  for(int64_t i{100}; i != 0; --i) {                                            // 100 down to 1, so order is scrambled
+    recorder.record(site, i);
+  }
+  auto const percentiles{recorder.get_percentiles(site, {0.99, 0.0, 0.5, 1.0})};
+  REQUIRE(percentiles.size() == 4);
+  CHECK(percentiles[0] == 99);
+  CHECK(percentiles[1] == 1);
+  CHECK(percentiles[2] == 51);
+  CHECK(percentiles[3] == 100);
+  CHECK(recorder.get_sample_count(site) == 100);                                // selection reorders the column but keeps every sample
+}
+
+TEST_CASE("get_percentiles selects across chunk boundaries", "[sample_recorder][percentile]") {
+  timestorm::sample_recorder recorder;
+  unsigned int const site{recorder.add_site("chunked")};
+  int64_t const count{static_cast<int64_t>(timestorm::sample_recorder::chunk_samples) * 3 + 1};
+  for(int64_t i{count}; i != 0; --i) {
+    recorder.record(site, i);
+  }
+  auto const percentiles{recorder.get_percentiles(site, {0.0, 0.5, 1.0})};
+  CHECK(percentiles[0] == 1);
+  CHECK(percentiles[1] == count / 2 + 1);
+  CHECK(percentiles[2] == count);
+  CHECK(recorder.get_stats(site).count == static_cast<uint64_t>(count));
+}
+
+TEST_CASE("get_percentiles rejects non-finite fractions", "[sample_recorder][percentile]") {
+  timestorm::sample_recorder recorder;
+  unsigned int const site{recorder.add_site("nan")};
+  recorder.record(site, int64_t{1});
+  CHECK_THROWS_AS(recorder.get_percentiles(site, {0.5, std::nan("")}), std::invalid_argument);
+  CHECK_THROWS_AS(recorder.get_percentiles(site, {std::numeric_limits<double>::infinity()}), std::invalid_argument);
+}
@@ -0,0 +1,233 @@
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <latch>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "timestorm/shared_stats.h"
+
+// Each test uses its own segment, unlinked again on the way out.
+struct segment_fixture {
+  std::string const name{"/timestorm_test_" + std::to_string(getpid())};
+
+  segment_fixture() {
+    timestorm::shared_stats::remove(name);
+  }
+  ~segment_fixture() {
+    timestorm::shared_stats::remove(name);
+  }
+};
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Sites
+// ─────────────────────────────────────────────────────────────────────────────
+
+TEST_CASE_METHOD(segment_fixture, "add_site returns the same index for the same name", "[shared_stats][site]") {
+  timestorm::shared_stats stats(name);
+  unsigned int const parse{stats.add_site("parse")};
+  unsigned int const plan{stats.add_site("plan")};
+  CHECK(parse != plan);
+  CHECK(stats.add_site("parse") == parse);
+
+  timestorm::shared_stats other(name);                                          // a second attachment sees the same table
+  CHECK(other.add_site("plan") == plan);
+}
+
+TEST_CASE_METHOD(segment_fixture, "snapshot lists registered sites in order", "[shared_stats][site]") {
+  timestorm::shared_stats stats(name);
+  stats.add_site("first");
+  stats.add_site("second");
+  auto const totals{stats.snapshot()};
+  REQUIRE(totals.sites.size() == 2);
+  CHECK(totals.sites[0].name == "first");
+  CHECK(totals.sites[1].name == "second");
+  CHECK(totals.sites[0].count == 0);
+}
+
+TEST_CASE_METHOD(segment_fixture, "add_site skips an entry abandoned part way through naming", "[shared_stats][site]") {
+  timestorm::shared_stats stats(name);
+  {                                                                             // mark the first entry as being named, as if its writer died mid-way
+    int const fd{shm_open(name.c_str(), O_RDWR, 0)};
+    REQUIRE(fd != -1);
+    void *const header{mmap(nullptr, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)};
+    close(fd);
+    REQUIRE(header != MAP_FAILED);
+    static_cast<uint64_t*>(header)[6] = 1;                                      // site_table[0].state follows six header fields
+    munmap(header, 4096);
+  }
+  auto const time_start{std::chrono::steady_clock::now()};
+  unsigned int const site{stats.add_site("after")};
+  CHECK(site == 1);
+  CHECK(stats.add_site("after") == 1);                                          // later calls skip the abandoned entry without waiting
+  CHECK(std::chrono::steady_clock::now() - time_start < std::chrono::seconds(1));
+
+  stats.record(site, std::chrono::nanoseconds(10));
+  auto const totals{stats.snapshot()};
+  REQUIRE(totals.sites.size() == 1);
+  CHECK(totals.sites[0].name == "after");
+  CHECK(totals.sites[0].site == 1);
+  CHECK(totals.sites[0].count == 1);
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Recording
+// ─────────────────────────────────────────────────────────────────────────────
+
+TEST_CASE_METHOD(segment_fixture, "record accumulates count, total, min, max and histogram", "[shared_stats][record]") {
+  timestorm::shared_stats stats(name);
+  unsigned int const site{stats.add_site("work")};
+  stats.record(site, std::chrono::nanoseconds(100));
+  stats.record(site, std::chrono::nanoseconds(300));
+  stats.record(site, std::chrono::nanoseconds(200));
+
+  auto const totals{stats.snapshot()};
+  REQUIRE(totals.sites.size() == 1);
+  auto const &work{totals.sites[0]};
+  CHECK(work.count    == 3);
+  CHECK(work.total_ns == 600);
+  CHECK(work.min_ns   == 100);
+  CHECK(work.max_ns   == 300);
+  CHECK(work.histogram[22] == 1);                                               // 100 is in [96, 112)
+  CHECK(work.histogram[26] == 1);                                               // 200 is in [192, 224)
+  CHECK(work.histogram[28] == 1);                                               // 300 is in [256, 320)
+  CHECK(totals.writers == 1);
+}
+
+TEST_CASE("histogram buckets are log-linear and cover every duration", "[shared_stats][histogram]") {
+  using stats = timestorm::shared_stats;
+  CHECK(stats::histogram_bucket(0) == 0);
+  CHECK(stats::histogram_bucket(3) == 3);
+  CHECK(stats::histogram_bucket(5'100'000) == 84);                              // 5.1ms is in [4.19ms, 5.24ms), not just [4.19ms, 8.39ms)
+  CHECK(stats::histogram_lower_bound(84) == 4'194'304);
+  CHECK(stats::histogram_bucket(std::numeric_limits<uint64_t>::max()) == stats::histogram_buckets - 1);
+  for(unsigned int bucket{0}; bucket + 1 != stats::histogram_buckets; ++bucket) {
+    uint64_t const lower{stats::histogram_lower_bound(bucket)};
+    uint64_t const upper{stats::histogram_lower_bound(bucket + 1)};
+    REQUIRE(lower < upper);
+    CHECK(stats::histogram_bucket(lower) == bucket);
+    CHECK(stats::histogram_bucket(upper - 1) == bucket);
+    CHECK(upper - lower <= std::max<uint64_t>(1, lower / stats::histogram_sub_buckets));
+  }
+}
+
+TEST_CASE_METHOD(segment_fixture, "scope records its lifetime", "[shared_stats][scope]") {
+  timestorm::shared_stats stats(name);
+  unsigned int const site{stats.add_site("sleep")};
+  {
+    timestorm::shared_stats::scope s(stats, site);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  auto const totals{stats.snapshot()};
+  REQUIRE(totals.sites.size() == 1);
+  CHECK(totals.sites[0].count == 1);
+  CHECK(totals.sites[0].total_ns >= 5'000'000);
+}
+
+TEST_CASE_METHOD(segment_fixture, "threads write separate slots that are summed by the reader", "[shared_stats][record]") {
+  timestorm::shared_stats stats(name);
+  unsigned int const site{stats.add_site("threaded")};
+  std::thread a([&]{ for(int i{0}; i != 1000; ++i) stats.record(site, std::chrono::nanoseconds(10)); });
+  std::thread b([&]{ for(int i{0}; i != 1000; ++i) stats.record(site, std::chrono::nanoseconds(10)); });
+  a.join();
+  b.join();
+  auto const totals{stats.snapshot()};
+  CHECK(totals.sites[0].count == 2000);
+  CHECK(totals.sites[0].total_ns == 20000);
+  CHECK(totals.writers == 0);                                                   // exited threads hand their slots back
+}
+
+TEST_CASE_METHOD(segment_fixture, "a thread alternating between objects keeps a slot in each", "[shared_stats][record]") {
+  timestorm::shared_stats first(name);
+  timestorm::shared_stats second(name);                                         // e.g. two components each attaching to the default segment
+  unsigned int const site{first.add_site("alternating")};
+  for(int i{0}; i != 1000; ++i) {
+    first.record(site, std::chrono::nanoseconds(10));
+    second.record(site, std::chrono::nanoseconds(10));
+  }
+  auto const totals{first.snapshot()};
+  CHECK(totals.sites[0].count == 2000);
+  CHECK(totals.writers == 2);                                                   // neither slot was given up on a switch
+}
+
+TEST_CASE_METHOD(segment_fixture, "samples are dropped rather than thrown when every slot is taken", "[shared_stats][record]") {
+  timestorm::shared_stats stats(name, timestorm::shared_stats::access::read_write, 2);
+  unsigned int const site{stats.add_site("crowded")};
+  std::latch recorded{3};
+  auto const writer{[&]{
+    stats.record(site, std::chrono::nanoseconds(10));
+    recorded.arrive_and_wait();                                                 // hold every slot until all three threads have recorded
+  }};
+  std::thread a(writer);
+  std::thread b(writer);
+  std::thread c(writer);
+  a.join();
+  b.join();
+  c.join();
+  auto const totals{stats.snapshot()};
+  CHECK(totals.slots == 2);
+  CHECK(totals.sites[0].count == 2);
+  CHECK(totals.dropped == 1);
+}
+
+TEST_CASE_METHOD(segment_fixture, "the first writer sets the slot count", "[shared_stats][record]") {
+  timestorm::shared_stats first(name, timestorm::shared_stats::access::read_write, 8);
+  timestorm::shared_stats second(name, timestorm::shared_stats::access::read_write, 512);
+  CHECK(second.snapshot().slots == 8);
+}
+
+TEST_CASE_METHOD(segment_fixture, "record drops samples for sites out of range", "[shared_stats][record]") {
+  timestorm::shared_stats stats(name);
+  stats.record(timestorm::shared_stats::max_sites, std::chrono::nanoseconds(10));
+  CHECK(stats.snapshot().dropped == 1);
+}
+
+TEST_CASE_METHOD(segment_fixture, "forked children record into the same segment", "[shared_stats][process]") {
+  timestorm::shared_stats stats(name);
+  unsigned int const site{stats.add_site("forked")};
+  stats.record(site, std::chrono::nanoseconds(1));                              // claim a slot in the parent before forking
+  for(int child{0}; child != 3; ++child) {
+    pid_t const pid{fork()};
+    REQUIRE(pid != -1);
+    if(pid == 0) {
+      for(int i{0}; i != 100; ++i) {
+        stats.record(site, std::chrono::nanoseconds(1));
+      }
+      _exit(0);
+    }
+  }
+  for(int child{0}; child != 3; ++child) {
+    wait(nullptr);
+  }
+  auto const totals{stats.snapshot()};
+  CHECK(totals.sites[0].count == 301);
+}
+
+TEST_CASE_METHOD(segment_fixture, "read-only attachment sees writer totals", "[shared_stats][reader]") {
+  timestorm::shared_stats writer(name);
+  unsigned int const site{writer.add_site("observed")};
+  writer.record(site, std::chrono::microseconds(2));
+
+  timestorm::shared_stats const reader(name, timestorm::shared_stats::access::read_only);
+  auto const totals{reader.snapshot()};
+  REQUIRE(totals.sites.size() == 1);
+  CHECK(totals.sites[0].name == "observed");
+  CHECK(totals.sites[0].total_ns == 2000);
+}
+
+TEST_CASE_METHOD(segment_fixture, "read-only attachment ignores record and only finds existing sites", "[shared_stats][reader]") {
+  timestorm::shared_stats writer(name);
+  unsigned int const site{writer.add_site("observed")};
+
+  timestorm::shared_stats reader(name, timestorm::shared_stats::access::read_only);
+  CHECK(reader.add_site("observed") == site);
+  CHECK_THROWS_AS(reader.add_site("missing"), std::out_of_range);
+  reader.record(site, std::chrono::microseconds(2));                            // nowhere to write, so nothing happens
+  auto const totals{reader.snapshot()};
+  CHECK(totals.sites[0].count == 0);
+  CHECK(totals.dropped == 0);
+}
@@ -0,0 +1,156 @@
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "timestorm/timestorm.h"
+
+// ─────────────────────────────────────────────────────────────────────────────
+// span_context
+// ─────────────────────────────────────────────────────────────────────────────
+
+TEST_CASE("no span is current by default", "[span_context]") {
+  CHECK(timestorm::current_span() == nullptr);
+  std::ostringstream oss;
+  timestorm::timer<float> t(static_cast<std::ostream&>(oss), "", "");
+  CHECK(t.span == nullptr);
+}
+
+TEST_CASE("span_scope installs and restores the current span", "[span_context]") {
+  timestorm::span_context outer(1);
+  timestorm::span_context inner(2);
+  {
+    timestorm::span_scope const outer_scope(&outer);
+    CHECK(timestorm::current_span() == &outer);
+    {
+      timestorm::span_scope const inner_scope(&inner);
+      CHECK(timestorm::current_span() == &inner);
+    }
+    CHECK(timestorm::current_span() == &outer);
+  }
+  CHECK(timestorm::current_span() == nullptr);
+}
+
+TEST_CASE("child spans share the request id and link to their parent", "[span_context]") {
+  timestorm::span_context root(42);
+  timestorm::span_context child(root);
+  CHECK(root.parent_id == 0);
+  CHECK(child.request_id == 42);
+  CHECK(child.parent_id == root.span_id);
+  CHECK(child.span_id != root.span_id);
+
+  child.record(std::chrono::nanoseconds(100));
+  CHECK(child.get_total_duration() == std::chrono::nanoseconds(100));
+  CHECK(root.get_total_duration()  == std::chrono::nanoseconds(100));
+  CHECK(root.get_scope_count() == 1);
+}
+
+TEST_CASE("timers record into the span current at construction", "[span_context][timer]") {
+  std::ostringstream oss;
+  timestorm::span_context request(7);
+  {
+    timestorm::span_scope const scope(&request);
+    timestorm::timer<float> t(static_cast<std::ostream&>(oss), "", "");
+    CHECK(t.span == &request);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  CHECK(request.get_scope_count() == 1);
+  CHECK(request.get_total_duration() >= std::chrono::milliseconds(5));
+}
+
+TEST_CASE("a span set on a timer after construction still gets its time", "[span_context][timer]") {
+  std::ostringstream oss;
+  timestorm::span_context request(6);
+  {
+    timestorm::timer<float> t(static_cast<std::ostream&>(oss), "", "");
+    t.span = &request;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  CHECK(request.get_scope_count() == 1);
+  CHECK(request.get_total_duration() >= std::chrono::milliseconds(4));          // from system_clock, so allow for its resolution
+  CHECK(request.get_total_duration() < std::chrono::seconds(10));
+}
+
+TEST_CASE("nested timers on one span each add their full time", "[span_context][timer]") {
+  std::ostringstream oss;
+  timestorm::span_context request(5);
+  {
+    timestorm::span_scope const scope(&request);
+    timestorm::timer<float> outer(static_cast<std::ostream&>(oss), "", "");
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    {
+      timestorm::timer<float> inner(static_cast<std::ostream&>(oss), "", "");
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    {
+      timestorm::timer<float> excluded(static_cast<std::ostream&>(oss), "", "");
+      excluded.span = nullptr;
+    }
+  }
+  CHECK(request.get_scope_count() == 2);                                        // outer and inner, not excluded
+  CHECK(request.get_total_duration() >= std::chrono::milliseconds(15));         // outer's 10ms plus inner's 5ms again
+}
+
+// A sink that takes a while to write, standing in for a slow log file or terminal.
+struct slow_sink {
+  template<typename V>
+  slow_sink &operator<<(V const&) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    return *this;
+  }
+};
+
+TEST_CASE("time spent writing the output is not recorded against the span", "[span_context][timer]") {
+  slow_sink sink;
+  timestorm::span_context request(8);
+  {
+    timestorm::span_scope const scope(&request);
+    {
+      timestorm::timer<float, slow_sink> t(sink, timestorm::timescale::AUTO, "", "");
+    }
+    {
+      timestorm::phase_timer<float, slow_sink> p(sink, "", "");
+    }
+  }
+  CHECK(request.get_scope_count() == 2);
+  CHECK(request.get_total_duration() < std::chrono::milliseconds(20));          // the timers themselves did nothing
+}
+
+TEST_CASE("bind_span carries the span onto other threads", "[span_context][thread]") {
+  timestorm::span_context request(9);
+  std::atomic<int> saw_span{0};
+  std::atomic<int> restored{0};
+  std::vector<std::function<void()>> tasks;
+  {
+    timestorm::span_scope const scope(&request);
+    for(int i{0}; i != 4; ++i) {
+      tasks.emplace_back(timestorm::bind_span([&saw_span, &request]{
+        std::ostringstream oss;                                                 // each thread writes its own sink
+        saw_span += timestorm::current_span() == &request;
+        timestorm::phase_timer<float> t(static_cast<std::ostream&>(oss), "", "");
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      }));
+    }
+  }
+  std::vector<std::thread> workers;
+  for(auto &task : tasks) {
+    workers.emplace_back([&task, &restored]{
+      task();
+      restored += timestorm::current_span() == nullptr;                         // the worker's own span is restored afterwards
+    });
+  }
+  for(auto &worker : workers) {
+    worker.join();
+  }
+  CHECK(saw_span == 4);
+  CHECK(restored == 4);
+  CHECK(request.get_scope_count() == 4);
+  CHECK(request.get_total_duration() >= std::chrono::milliseconds(8));
+}
+
+TEST_CASE("bind_span forwards arguments and return values", "[span_context]") {
+  auto add{timestorm::bind_span([](int a, int b){ return a + b; })};
+  CHECK(add(2, 3) == 5);
+}
@@ -151,6 +151,20 @@ TEST_CASE("get_unit returns correct string for explicit timescales", "[timer][ge
     timestorm::timer<float> t(static_cast<std::ostream&>(oss), timestorm::timescale::HOURS, "", "");
     CHECK(t.get_unit() == "h");
   }
+
+  SECTION("DAYS → d") {
+    timestorm::timer<float> t(static_cast<std::ostream&>(oss), timestorm::timescale::DAYS, "", "");
+    CHECK(t.get_unit() == "d");
+  }
+}
+
+TEST_CASE("AUTO scale reaches days for long running timers", "[timer][get_unit]") {
+  std::ostringstream oss;
+  timestorm::timer<double> t(static_cast<std::ostream&>(oss), "", "");
+  t.time_start -= std::chrono::hours(48);
+  CHECK(t.get_time() >= 2.0);
+  CHECK(t.scale == timestorm::timescale::DAYS);
+  CHECK(t.get_unit() == "d");
 }
 
 TEST_CASE("output contains the correct unit string for explicit scales", "[timer][output]") {
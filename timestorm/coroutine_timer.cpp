@@ -0,0 +1,11 @@
+#include "coroutine_timer.h"
+
+namespace timestorm {
+
+// explicit instantiations
+template class coroutine_timer<float, std::ostream>;
+template class coroutine_timer<double, std::ostream>;
+template class coroutine_timer<int, std::ostream>;
+template class coroutine_timer<unsigned int, std::ostream>;
+
+}
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "timescale.h"
+#include "timer.h"
+
+namespace timestorm {
+
+template<typename T = default_timer_type, typename sink_t = std::ostream>
+class coroutine_timer {
+  /// Times a coroutine, separating time spent running from time spent suspended.
+  /// Wrap each co_await with wrap() so the timer pauses while the coroutine is suspended:
+  ///   co_await timer.wrap(socket.async_read(buffer));
+  sink_t &sink;
+
+  std::chrono::steady_clock::time_point time_last = std::chrono::steady_clock::now(); // when the current running or suspended span began
+  std::chrono::nanoseconds active{0};
+  std::chrono::nanoseconds suspended{0};
+  unsigned int suspensions{0};
+  bool paused{false};
+
+  template<typename awaitable_t>
+  class awaiter {
+    /// Forwards to the wrapped awaitable, pausing the timer around the suspension
+    static decltype(auto) get_awaiter(auto &&awaitable) {
+      if constexpr(requires{static_cast<decltype(awaitable)>(awaitable).operator co_await();}) {
+        return static_cast<decltype(awaitable)>(awaitable).operator co_await();
+      } else if constexpr(requires{operator co_await(static_cast<decltype(awaitable)>(awaitable));}) {
+        return operator co_await(static_cast<decltype(awaitable)>(awaitable));
+      } else {
+        return (awaitable);                                                     // already an awaiter, so use it in place
+      }
+    }
+
+    coroutine_timer &timer;
+    awaitable_t awaitable;
+    decltype(get_awaiter(std::declval<awaitable_t>())) inner;
+
+  public:
+    awaiter(coroutine_timer &this_timer, awaitable_t &&this_awaitable);
+    awaiter(awaiter const&) = delete;
+    awaiter &operator=(awaiter const&) = delete;
+
+    bool await_ready();
+    template<typename promise_t>
+    auto await_suspend(std::coroutine_handle<promise_t> handle);
+    decltype(auto) await_resume();
+  };
+
+public:
+  std::function<std::string()> prefix;                                          // what to run to generate output when finished before the time values
+  std::function<std::string()> suffix;                                          // what to run to generate output when finished after the time values
+  timescale scale{timescale::AUTO};                                             // on what timescale to report the results
+  span_context *span{current_span()};                                           // which request the active time is recorded against, if any
+
+  coroutine_timer(timescale new_scale,
+                  std::string const &message_pre  = "Done in ",
+                  std::string const &message_post = ".\n");
+  coroutine_timer(std::string const &message_pre  = "Done in ",
+                  std::string const &message_post = ".\n");
+  coroutine_timer(streamlike auto &sink,
+                  timescale new_scale,
+                  std::string const &message_pre  = "Done in ",
+                  std::string const &message_post = ".\n");
+  coroutine_timer(streamlike auto &sink,
+                  std::string const &message_pre  = "Done in ",
+                  std::string const &message_post = ".\n");
+  ~coroutine_timer();
+
+  template<typename awaitable_t>
+  awaiter<awaitable_t> wrap(awaitable_t &&awaitable);
+  void pause();
+  void resume();
+
+  void output();
+  void reset();
+  std::chrono::nanoseconds get_active_duration() const;
+  std::chrono::nanoseconds get_suspended_duration() const;
+  unsigned int get_suspensions() const;
+
+private:
+  void output_duration(std::chrono::nanoseconds duration);
+};
+
+template<typename T, typename sink_t>
+template<typename awaitable_t>
+coroutine_timer<T, sink_t>::awaiter<awaitable_t>::awaiter(coroutine_timer &this_timer, awaitable_t &&this_awaitable)
+  : timer{this_timer},
+    awaitable(std::forward<awaitable_t>(this_awaitable)),
+    inner(get_awaiter(std::forward<awaitable_t>(awaitable))) {
+  /// Default constructor
+}
+
+template<typename T, typename sink_t>
+template<typename awaitable_t>
+bool coroutine_timer<T, sink_t>::awaiter<awaitable_t>::await_ready() {
+  return inner.await_ready();
+}
+
+template<typename T, typename sink_t>
+template<typename awaitable_t>
+template<typename promise_t>
+auto coroutine_timer<T, sink_t>::awaiter<awaitable_t>::await_suspend(std::coroutine_handle<promise_t> handle) {
+  /// Pause before handing over, as the coroutine may be resumed - even on another thread - before inner.await_suspend returns
+  timer.pause();
+  using result_t = decltype(inner.await_suspend(handle));
+  if constexpr(std::is_same<result_t, bool>::value) {
+    bool const suspending{inner.await_suspend(handle)};
+    if(!suspending) {                                                           // not suspended after all, so this is still active time
+      timer.paused = false;
+      timer.suspensions--;
+    }
+    return suspending;
+  } else {
+    return inner.await_suspend(handle);
+  }
+}
+
+template<typename T, typename sink_t>
+template<typename awaitable_t>
+decltype(auto) coroutine_timer<T, sink_t>::awaiter<awaitable_t>::await_resume() {
+  timer.resume();
+  return inner.await_resume();
+}
+
+template<typename T, typename sink_t>
+coroutine_timer<T, sink_t>::coroutine_timer(timescale new_scale,
+                                            std::string const &message_pre,
+                                            std::string const &message_post)
+  : coroutine_timer(std::cout,
+                    new_scale,
+                    message_pre,
+                    message_post) {
+  /// Passthrough constructor: default sink
+}
+
+template<typename T, typename sink_t>
+coroutine_timer<T, sink_t>::coroutine_timer(std::string const &message_pre,
+                                            std::string const &message_post)
+  : coroutine_timer(std::cout,
+                    message_pre,
+                    message_post) {
+  /// Passthrough constructor: default sink and scale
+}
+
+template<typename T, typename sink_t>
+coroutine_timer<T, sink_t>::coroutine_timer(streamlike auto &this_sink,
+                                            timescale new_scale,
+                                            std::string const &message_pre,
+                                            std::string const &message_post)
+  : sink{this_sink},
+    prefix([message_pre]{return message_pre;}),
+    suffix([message_post]{return message_post;}),
+    scale(new_scale) {
+  /// Specific constructor
+}
+
+template<typename T, typename sink_t>
+coroutine_timer<T, sink_t>::coroutine_timer(streamlike auto &this_sink,
+                                            std::string const &message_pre,
+                                            std::string const &message_post)
+  : coroutine_timer(this_sink,
+                    timescale::AUTO,
+                    message_pre,
+                    message_post) {
+  /// Passthrough constructor: default scale
+}
+
+template<typename T, typename sink_t>
+coroutine_timer<T, sink_t>::~coroutine_timer() {
+  /// Default destructor
+  auto const active_duration{get_active_duration()};                            // read before output, so the span isn't charged for it
+  output();                                                                     // output the times on destruction
+  if(span) {
+    span->record(active_duration);
+  }
+}
+
+template<typename T, typename sink_t>
+template<typename awaitable_t>
+typename coroutine_timer<T, sink_t>::template awaiter<awaitable_t> coroutine_timer<T, sink_t>::wrap(awaitable_t &&awaitable) {
+  /// Wrap an awaitable so that time spent suspended in it is not counted as active
+  return {*this, std::forward<awaitable_t>(awaitable)};
+}
+
+template<typename T, typename sink_t>
+void coroutine_timer<T, sink_t>::pause() {
+  /// Stop counting active time, for suspensions that wrap() cannot see
+  if(paused) {
+    return;
+  }
+  auto const now{std::chrono::steady_clock::now()};
+  active += now - time_last;
+  time_last = now;
+  paused = true;
+  ++suspensions;
+}
+
+template<typename T, typename sink_t>
+void coroutine_timer<T, sink_t>::resume() {
+  /// Start counting active time again
+  if(!paused) {
+    return;
+  }
+  auto const now{std::chrono::steady_clock::now()};
+  suspended += now - time_last;
+  time_last = now;
+  paused = false;
+}
+
+template<typename T, typename sink_t>
+void coroutine_timer<T, sink_t>::output() {
+  /// Output the present active and suspended times
+  sink << prefix();
+  output_duration(get_active_duration());
+  sink << " active, ";
+  output_duration(get_suspended_duration());
+  sink << " suspended, " << std::to_string(suspensions) << (suspensions == 1 ? " suspension" : " suspensions") << suffix();
+  if constexpr(std::is_same<sink_t, std::ostream>::value) {                     // flush std::ostream only
+    sink << std::flush;
+  }
+}
+
+template<typename T, typename sink_t>
+void coroutine_timer<T, sink_t>::reset() {
+  /// Reset all times and the suspension count to zero.  If suspended now, that suspension carries on and counts as the first.
+  time_last = std::chrono::steady_clock::now();
+  active = std::chrono::nanoseconds{0};
+  suspended = std::chrono::nanoseconds{0};
+  suspensions = paused ? 1 : 0;
+}
+
+template<typename T, typename sink_t>
+std::chrono::nanoseconds coroutine_timer<T, sink_t>::get_active_duration() const {
+  /// Time spent running, including the current span if running now
+  return paused ? active : active + std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - time_last);
+}
+
+template<typename T, typename sink_t>
+std::chrono::nanoseconds coroutine_timer<T, sink_t>::get_suspended_duration() const {
+  /// Time spent suspended, including the current span if suspended now
+  return paused ? suspended + std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - time_last) : suspended;
+}
+
+template<typename T, typename sink_t>
+unsigned int coroutine_timer<T, sink_t>::get_suspensions() const {
+  return suspensions;
+}
+
+template<typename T, typename sink_t>
+void coroutine_timer<T, sink_t>::output_duration(std::chrono::nanoseconds duration) {
+  /// Output one duration with its unit
+  timescale const this_scale{scale == timescale::AUTO ? auto_timescale(duration) : scale};
+  sink << std::fixed << std::setprecision(1) << scale_duration<T>(duration, this_scale) << timescale_unit(this_scale);
+}
+
+#ifdef TIMESTORM_EXTERN_TEMPLATES
+// explicit instantiations live in coroutine_timer.cpp
+extern template class coroutine_timer<float, std::ostream>;
+extern template class coroutine_timer<double, std::ostream>;
+extern template class coroutine_timer<int, std::ostream>;
+extern template class coroutine_timer<unsigned int, std::ostream>;
+#endif // TIMESTORM_EXTERN_TEMPLATES
+
+}
@@ -0,0 +1,11 @@
+#include "phase_timer.h"
+
+namespace timestorm {
+
+// explicit instantiations
+template class phase_timer<float, std::ostream>;
+template class phase_timer<double, std::ostream>;
+template class phase_timer<int, std::ostream>;
+template class phase_timer<unsigned int, std::ostream>;
+
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include "timescale.h"
+#include "timer.h"
+
+namespace timestorm {
+
+template<typename T = default_timer_type, typename sink_t = std::ostream, unsigned int max_phases = 16>
+class phase_timer {
+  /// Breaks one scope into named phases, reported together on a single line:
+  /// "parse 1.2ms, plan 0.3ms, exec 14.0ms, total 15.5ms"
+  /// Phase names, prefix and suffix are not copied, so they must outlive the timer - string literals are ideal.
+  static_assert(max_phases > 0, "phase_timer needs room for at least one phase");
+  sink_t &sink;
+
+  struct phase {
+    char const *name;
+    std::chrono::steady_clock::time_point time_end;
+  };
+  std::array<phase, max_phases> phases{};
+  unsigned int phase_count{0};
+  unsigned int phases_merged{0};                                                // splits past max_phases, folded into the last phase
+
+public:
+  std::chrono::steady_clock::time_point time_start = std::chrono::steady_clock::now();
+
+  char const *prefix;                                                           // output before the phase list
+  char const *suffix;                                                           // output after the total
+  timescale scale{timescale::AUTO};                                             // on what timescale to report the results; AUTO picks per phase
+  span_context *span{current_span()};                                           // which request the total is recorded against, if any
+
+  phase_timer(timescale new_scale,
+              char const *message_pre  = "",
+              char const *message_post = ".\n");
+  phase_timer(char const *message_pre  = "",
+              char const *message_post = ".\n");
+  phase_timer(streamlike auto &sink,
+              timescale new_scale,
+              char const *message_pre  = "",
+              char const *message_post = ".\n");
+  phase_timer(streamlike auto &sink,
+              char const *message_pre  = "",
+              char const *message_post = ".\n");
+  ~phase_timer();
+
+  void split(char const *name);
+  void output();
+  void reset();
+  unsigned int get_phase_count() const;
+  unsigned int get_phases_merged() const;
+  std::chrono::nanoseconds get_phase_duration(unsigned int index) const;
+  std::chrono::nanoseconds get_total_duration() const;
+
+private:
+  void output_duration(std::chrono::nanoseconds duration);
+};
+
+template<typename T, typename sink_t, unsigned int max_phases>
+phase_timer<T, sink_t, max_phases>::phase_timer(timescale new_scale,
+                                                char const *message_pre,
+                                                char const *message_post)
+  : phase_timer(std::cout,
+                new_scale,
+                message_pre,
+                message_post) {
+  /// Passthrough constructor: default sink
+}
+
+template<typename T, typename sink_t, unsigned int max_phases>
+phase_timer<T, sink_t, max_phases>::phase_timer(char const *message_pre,
+                                                char const *message_post)
+  : phase_timer(std::cout,
+                message_pre,
+                message_post) {
+  /// Passthrough constructor: default sink and scale
+}
+
+template<typename T, typename sink_t, unsigned int max_phases>
+phase_timer<T, sink_t, max_phases>::phase_timer(streamlike auto &this_sink,
+                                                timescale new_scale,
+                                                char const *message_pre,
+                                                char const *message_post)
+  : sink{this_sink},
+    prefix{message_pre},
+    suffix{message_post},
+    scale{new_scale} {
+  /// Specific constructor
+}
+
+template<typename T, typename sink_t, unsigned int max_phases>
+phase_timer<T, sink_t, max_phases>::phase_timer(streamlike auto &this_sink,
+                                                char const *message_pre,
+                                                char const *message_post)
+  : phase_timer(this_sink,
+                timescale::AUTO,
+                message_pre,
+                message_post) {
+  /// Passthrough constructor: default scale
+}
+
+template<typename T, typename sink_t, unsigned int max_phases>
+phase_timer<T, sink_t, max_phases>::~phase_timer() {
+  /// Default destructor
+  auto const total{get_total_duration()};                                       // read before output, so the span isn't charged for it
+  output();                                                                     // output the phases on destruction
+  if(span) {
+    span->record(total);
+  }
+}
+
+template<typename T, typename sink_t, unsigned int max_phases>
+void phase_timer<T, sink_t, max_phases>::split(char const *name) {
+  /// End the current phase, naming it.  Once all phases are used, later splits extend the last one,
+  /// which is then reported as "name +N more" so the extra time isn't silently charged to it.
+  auto const now{std::chrono::steady_clock::now()};
+  if(phase_count == max_phases) [[unlikely]] {
+    phases[max_phases - 1].time_end = now;
+    ++phases_merged;
+    return;
+  }
+  phases[phase_count++] = {name, now};
+}
+
+template<typename T, typename sink_t, unsigned int max_phases>
+void phase_timer<T, sink_t, max_phases>::output() {
+  /// Output every phase so far followed by the total
+  sink << prefix;
+  for(unsigned int index{0}; index != phase_count; ++index) {
+    sink << phases[index].name << " ";
+    if(index == max_phases - 1 && phases_merged != 0) [[unlikely]] {
+      sink << "+" << std::to_string(phases_merged) << " more ";
+    }
+    output_duration(get_phase_duration(index));
+    sink << ", ";
+  }
+  sink << "total ";
+  output_duration(get_total_duration());
+  sink << suffix;
+  if constexpr(std::is_same<sink_t, std::ostream>::value) {                     // flush std::ostream only
+    sink << std::flush;
+  }
+}
+
+template<typename T, typename sink_t, unsigned int max_phases>
+void phase_timer<T, sink_t, max_phases>::reset() {
+  /// Discard all phases and restart the timer
+  phase_count = 0;
+  phases_merged = 0;
+  time_start = std::chrono::steady_clock::now();
+}
+
+template<typename T, typename sink_t, unsigned int max_phases>
+unsigned int phase_timer<T, sink_t, max_phases>::get_phase_count() const {
+  return phase_count;
+}
+
+template<typename T, typename sink_t, unsigned int max_phases>
+unsigned int phase_timer<T, sink_t, max_phases>::get_phases_merged() const {
+  return phases_merged;
+}
+
+template<typename T, typename sink_t, unsigned int max_phases>
+std::chrono::nanoseconds phase_timer<T, sink_t, max_phases>::get_phase_duration(unsigned int index) const {
+  /// Time taken by one completed phase
+  auto const time_begin{index == 0 ? time_start : phases[index - 1].time_end};
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(phases[index].time_end - time_begin);
+}
+
+template<typename T, typename sink_t, unsigned int max_phases>
+std::chrono::nanoseconds phase_timer<T, sink_t, max_phases>::get_total_duration() const {
+  /// Time since construction or the last reset
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - time_start);
+}
+
+template<typename T, typename sink_t, unsigned int max_phases>
+void phase_timer<T, sink_t, max_phases>::output_duration(std::chrono::nanoseconds duration) {
+  /// Output one duration with its unit
+  timescale const this_scale{scale == timescale::AUTO ? auto_timescale(duration) : scale};
+  sink << std::fixed << std::setprecision(1) << scale_duration<T>(duration, this_scale) << timescale_unit(this_scale);
+}
+
+#ifdef TIMESTORM_EXTERN_TEMPLATES
+// explicit instantiations live in phase_timer.cpp
+extern template class phase_timer<float, std::ostream>;
+extern template class phase_timer<double, std::ostream>;
+extern template class phase_timer<int, std::ostream>;
+extern template class phase_timer<unsigned int, std::ostream>;
+#endif // TIMESTORM_EXTERN_TEMPLATES
+
+}
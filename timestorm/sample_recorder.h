@@ -0,0 +1,402 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace timestorm {
+
+struct sample_stats {
+  /// Summary of a column of raw samples, in nanoseconds
+  uint64_t count{0};
+  int64_t min{0};
+  int64_t max{0};
+  double mean{0.0};
+  double variance{0.0};                                                         // population variance
+
+  void merge(sample_stats const &other);
+};
+
+class sample_recorder {
+  /// Keeps every raw duration, one column per site, in fixed-size chunks drawn from a bounded budget.
+  /// Not thread safe: use one recorder per thread, and merge() their stats afterwards.
+public:
+  static size_t constexpr chunk_samples{size_t{1} << 16};                       // 512KiB per chunk
+
+private:
+  struct column {
+    std::string name;
+    std::vector<std::unique_ptr<int64_t[]>> chunks;
+    int64_t *cursor{nullptr};                                                   // next free sample in the last chunk
+    int64_t *end{nullptr};
+
+    size_t size() const;
+    std::span<int64_t const> chunk(size_t index) const;
+  };
+
+  std::vector<column> columns;
+  size_t max_chunks;
+  size_t chunk_count{0};
+  uint64_t dropped{0};
+
+  bool grow(column &this_column);
+
+public:
+  class scope {
+    /// RAII helper recording the lifetime of the scope against a site
+    sample_recorder &recorder;
+    unsigned int site;
+    std::chrono::steady_clock::time_point time_start{std::chrono::steady_clock::now()};
+
+  public:
+    scope(sample_recorder &this_recorder, unsigned int this_site);
+    ~scope();
+  };
+
+  explicit sample_recorder(size_t max_samples = size_t{1} << 27);               // 1GiB of samples by default
+
+  unsigned int add_site(std::string const &site_name);
+  void record(unsigned int site, int64_t nanoseconds);
+  void record(unsigned int site, std::chrono::nanoseconds duration);
+  void clear();
+
+  std::string const &get_site_name(unsigned int site) const;
+  unsigned int get_site_count() const;
+  size_t get_sample_count(unsigned int site) const;
+  uint64_t get_dropped() const;
+
+  sample_stats get_stats(unsigned int site) const;
+  std::vector<int64_t> get_percentiles(unsigned int site, std::vector<double> const &fractions);
+
+  template<typename function_t>
+  void for_each_chunk(unsigned int site, function_t &&function) const;
+};
+
+namespace detail {
+
+// Kernels are written as fixed-width lane loops with no loop-carried dependency between lanes, so
+// GCC and Clang vectorise them at -O2 and above - with AVX2 when built with -mavx2 or -march=native.
+inline size_t constexpr sample_lanes{8};
+
+inline void sample_min_max(std::span<int64_t const> samples, int64_t &min, int64_t &max) {
+  int64_t lane_min[sample_lanes];
+  int64_t lane_max[sample_lanes];
+  std::fill(std::begin(lane_min), std::end(lane_min), min);
+  std::fill(std::begin(lane_max), std::end(lane_max), max);
+  size_t const whole{samples.size() - samples.size() % sample_lanes};
+  for(size_t i{0}; i != whole; i += sample_lanes) {
+    for(size_t lane{0}; lane != sample_lanes; ++lane) {
+      lane_min[lane] = std::min(lane_min[lane], samples[i + lane]);
+      lane_max[lane] = std::max(lane_max[lane], samples[i + lane]);
+    }
+  }
+  for(size_t i{whole}; i != samples.size(); ++i) {
+    lane_min[0] = std::min(lane_min[0], samples[i]);
+    lane_max[0] = std::max(lane_max[0], samples[i]);
+  }
+  min = *std::min_element(std::begin(lane_min), std::end(lane_min));
+  max = *std::max_element(std::begin(lane_max), std::end(lane_max));
+}
+
+class sample_iterator {
+  /// Random access across the chunks of one column, so std::nth_element can select in place
+  std::unique_ptr<int64_t[]> const *chunks{nullptr};
+  std::ptrdiff_t index{0};
+
+public:
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type = int64_t;
+  using difference_type = std::ptrdiff_t;
+  using pointer = int64_t*;
+  using reference = int64_t&;
+
+  sample_iterator() = default;
+  sample_iterator(std::unique_ptr<int64_t[]> const *these_chunks, std::ptrdiff_t this_index);
+
+  reference operator*() const {return chunks[static_cast<size_t>(index) / sample_recorder::chunk_samples][static_cast<size_t>(index) % sample_recorder::chunk_samples];}
+  pointer operator->() const {return &**this;}
+  reference operator[](difference_type offset) const {return *(*this + offset);}
+  sample_iterator &operator++() {++index; return *this;}
+  sample_iterator &operator--() {--index; return *this;}
+  sample_iterator operator++(int) {auto const old{*this}; ++index; return old;}
+  sample_iterator operator--(int) {auto const old{*this}; --index; return old;}
+  sample_iterator &operator+=(difference_type offset) {index += offset; return *this;}
+  sample_iterator &operator-=(difference_type offset) {index -= offset; return *this;}
+  sample_iterator operator+(difference_type offset) const {return {chunks, index + offset};}
+  sample_iterator operator-(difference_type offset) const {return {chunks, index - offset};}
+  friend sample_iterator operator+(difference_type offset, sample_iterator const &it) {return it + offset;}
+  difference_type operator-(sample_iterator const &other) const {return index - other.index;}
+  auto operator<=>(sample_iterator const &other) const {return index <=> other.index;}
+  bool operator==(sample_iterator const &other) const {return index == other.index;}
+};
+
+inline sample_iterator::sample_iterator(std::unique_ptr<int64_t[]> const *these_chunks, std::ptrdiff_t this_index)
+  : chunks{these_chunks},
+    index{this_index} {
+  /// Default constructor
+}
+
+inline int64_t constexpr sample_exact_limit{int64_t{1} << 47};                 // 2^47ns is 39 hours; a chunk of smaller magnitudes sums within int64_t
+
+inline int64_t sample_sum(std::span<int64_t const> samples) {
+  /// Exact integer sum; only for at most one chunk of samples within sample_exact_limit, or it may overflow
+  int64_t lane_sum[sample_lanes]{};
+  size_t const whole{samples.size() - samples.size() % sample_lanes};
+  for(size_t i{0}; i != whole; i += sample_lanes) {
+    for(size_t lane{0}; lane != sample_lanes; ++lane) {
+      lane_sum[lane] += samples[i + lane];
+    }
+  }
+  for(size_t i{whole}; i != samples.size(); ++i) {
+    lane_sum[0] += samples[i];
+  }
+  int64_t sum{0};
+  for(int64_t const this_sum : lane_sum) {
+    sum += this_sum;
+  }
+  return sum;
+}
+
+inline double sample_sum_wide(std::span<int64_t const> samples) {
+  /// Floating point sum for chunks holding samples too large for sample_sum(), such as raw timestamps or markers
+  double lane_sum[sample_lanes]{};
+  size_t const whole{samples.size() - samples.size() % sample_lanes};
+  for(size_t i{0}; i != whole; i += sample_lanes) {
+    for(size_t lane{0}; lane != sample_lanes; ++lane) {
+      lane_sum[lane] += static_cast<double>(samples[i + lane]);
+    }
+  }
+  for(size_t i{whole}; i != samples.size(); ++i) {
+    lane_sum[0] += static_cast<double>(samples[i]);
+  }
+  double sum{0.0};
+  for(double const this_sum : lane_sum) {
+    sum += this_sum;
+  }
+  return sum;
+}
+
+inline double sample_squared_deviation(std::span<int64_t const> samples, double mean) {
+  double lane_sum[sample_lanes]{};
+  size_t const whole{samples.size() - samples.size() % sample_lanes};
+  for(size_t i{0}; i != whole; i += sample_lanes) {
+    for(size_t lane{0}; lane != sample_lanes; ++lane) {
+      double const deviation{static_cast<double>(samples[i + lane]) - mean};
+      lane_sum[lane] += deviation * deviation;
+    }
+  }
+  for(size_t i{whole}; i != samples.size(); ++i) {
+    double const deviation{static_cast<double>(samples[i]) - mean};
+    lane_sum[0] += deviation * deviation;
+  }
+  double sum{0.0};
+  for(double const this_sum : lane_sum) {
+    sum += this_sum;
+  }
+  return sum;
+}
+
+}
+
+inline void sample_stats::merge(sample_stats const &other) {
+  /// Combine with the stats of another column, such as the same site on another thread's recorder
+  if(other.count == 0) {
+    return;
+  }
+  if(count == 0) {
+    *this = other;
+    return;
+  }
+  double const total{static_cast<double>(count + other.count)};
+  double const delta{other.mean - mean};
+  double const squared_deviation{variance * static_cast<double>(count) +
+                                 other.variance * static_cast<double>(other.count) +
+                                 delta * delta * static_cast<double>(count) * static_cast<double>(other.count) / total};
+  mean += delta * static_cast<double>(other.count) / total;
+  variance = squared_deviation / total;
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+  count += other.count;
+}
+
+inline size_t sample_recorder::column::size() const {
+  if(chunks.empty()) {
+    return 0;
+  }
+  return (chunks.size() - 1) * chunk_samples + static_cast<size_t>(cursor - chunks.back().get());
+}
+
+inline std::span<int64_t const> sample_recorder::column::chunk(size_t index) const {
+  /// Filled part of one chunk
+  return {chunks[index].get(), index + 1 == chunks.size() ? static_cast<size_t>(cursor - chunks[index].get()) : chunk_samples};
+}
+
+inline sample_recorder::scope::scope(sample_recorder &this_recorder, unsigned int this_site)
+  : recorder{this_recorder},
+    site{this_site} {
+  /// Default constructor
+}
+
+inline sample_recorder::scope::~scope() {
+  /// Record the time taken on destruction
+  recorder.record(site, std::chrono::steady_clock::now() - time_start);
+}
+
+inline sample_recorder::sample_recorder(size_t max_samples)
+  : max_chunks{(max_samples + chunk_samples - 1) / chunk_samples} {
+  /// Default constructor; memory is taken a chunk at a time, up to max_samples rounded up to whole chunks
+}
+
+inline bool sample_recorder::grow(column &this_column) {
+  /// Give a column a fresh chunk, if the budget allows
+  if(chunk_count == max_chunks) {
+    return false;
+  }
+  this_column.chunks.emplace_back(std::make_unique_for_overwrite<int64_t[]>(chunk_samples));
+  ++chunk_count;
+  this_column.cursor = this_column.chunks.back().get();
+  this_column.end = this_column.cursor + chunk_samples;
+  return true;
+}
+
+inline unsigned int sample_recorder::add_site(std::string const &site_name) {
+  /// Find or add a named column, returning its index for use with record()
+  for(unsigned int site{0}; site != columns.size(); ++site) {
+    if(columns[site].name == site_name) {
+      return site;
+    }
+  }
+  columns.emplace_back().name = site_name;
+  return static_cast<unsigned int>(columns.size() - 1);
+}
+
+inline void sample_recorder::record(unsigned int site, int64_t nanoseconds) {
+  /// Append one raw sample; once the budget is spent, samples are counted as dropped instead.
+  /// Any value is accepted, but get_stats() only sums a chunk exactly while its samples stay within 2^47ns (39 hours).
+  column &this_column{columns[site]};
+  if(this_column.cursor == this_column.end) [[unlikely]] {
+    if(!grow(this_column)) {
+      ++dropped;
+      return;
+    }
+  }
+  *this_column.cursor++ = nanoseconds;
+}
+
+inline void sample_recorder::record(unsigned int site, std::chrono::nanoseconds duration) {
+  record(site, static_cast<int64_t>(duration.count()));
+}
+
+inline void sample_recorder::clear() {
+  /// Discard all samples and release their memory, keeping the sites
+  for(auto &this_column : columns) {
+    this_column.chunks.clear();
+    this_column.cursor = nullptr;
+    this_column.end = nullptr;
+  }
+  chunk_count = 0;
+  dropped = 0;
+}
+
+inline std::string const &sample_recorder::get_site_name(unsigned int site) const {
+  return columns[site].name;
+}
+
+inline unsigned int sample_recorder::get_site_count() const {
+  return static_cast<unsigned int>(columns.size());
+}
+
+inline size_t sample_recorder::get_sample_count(unsigned int site) const {
+  return columns[site].size();
+}
+
+inline uint64_t sample_recorder::get_dropped() const {
+  return dropped;
+}
+
+inline sample_stats sample_recorder::get_stats(unsigned int site) const {
+  /// Two passes over the column: min, max and sum, then the squared deviation from the mean
+  column const &this_column{columns[site]};
+  sample_stats result;
+  result.count = this_column.size();
+  if(result.count == 0) {
+    return result;
+  }
+  result.min = std::numeric_limits<int64_t>::max();
+  result.max = std::numeric_limits<int64_t>::min();
+  double sum{0.0};
+  for(size_t index{0}; index != this_column.chunks.size(); ++index) {
+    auto const samples{this_column.chunk(index)};
+    int64_t chunk_min{std::numeric_limits<int64_t>::max()};
+    int64_t chunk_max{std::numeric_limits<int64_t>::min()};
+    detail::sample_min_max(samples, chunk_min, chunk_max);
+    result.min = std::min(result.min, chunk_min);
+    result.max = std::max(result.max, chunk_max);
+    if(chunk_min > -detail::sample_exact_limit && chunk_max < detail::sample_exact_limit) [[likely]] {
+      sum += static_cast<double>(detail::sample_sum(samples));
+    } else {                                                                    // any value is accepted, but summing it exactly could overflow
+      sum += detail::sample_sum_wide(samples);
+    }
+  }
+  result.mean = sum / static_cast<double>(result.count);
+  double squared_deviation{0.0};
+  for(size_t index{0}; index != this_column.chunks.size(); ++index) {
+    squared_deviation += detail::sample_squared_deviation(this_column.chunk(index), result.mean);
+  }
+  result.variance = squared_deviation / static_cast<double>(result.count);
+  return result;
+}
+
+inline std::vector<int64_t> sample_recorder::get_percentiles(unsigned int site, std::vector<double> const &fractions) {
+  /// Exact percentiles by selection, for fractions from 0.0 to 1.0.
+  /// Selects in place, so it takes no memory beyond the result but leaves the column in no particular order -
+  /// export with for_each_chunk() first if recorded order matters.  Each selection only searches above the previous one.
+  for(double const fraction : fractions) {
+    if(!std::isfinite(fraction)) {
+      throw std::invalid_argument("timestorm: percentile fraction must be finite");
+    }
+  }
+  std::vector<size_t> order(fractions.size());
+  for(size_t i{0}; i != order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&fractions](size_t a, size_t b){return fractions[a] < fractions[b];});
+
+  std::vector<int64_t> result(fractions.size(), 0);
+  column &this_column{columns[site]};
+  size_t const count{this_column.size()};
+  if(count == 0) {
+    return result;
+  }
+  detail::sample_iterator const begin{this_column.chunks.data(), 0};
+  detail::sample_iterator const end{begin + static_cast<std::ptrdiff_t>(count)};
+  auto first{begin};
+  for(size_t const i : order) {
+    double const fraction{std::clamp(fractions[i], 0.0, 1.0)};
+    auto const nth{begin + static_cast<std::ptrdiff_t>(std::llround(fraction * static_cast<double>(count - 1)))};
+    std::nth_element(first, nth, end);
+    result[i] = *nth;
+    first = nth;
+  }
+  return result;
+}
+
+template<typename function_t>
+void sample_recorder::for_each_chunk(unsigned int site, function_t &&function) const {
+  /// Visit the raw samples of a column in recorded order, one std::span<int64_t const> per chunk, e.g. for export
+  column const &this_column{columns[site]};
+  for(size_t index{0}; index != this_column.chunks.size(); ++index) {
+    function(this_column.chunk(index));
+  }
+}
+
+}
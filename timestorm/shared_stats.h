@@ -0,0 +1,521 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace timestorm {
+
+class shared_stats {
+  /// Cross-process timing statistics in a POSIX shared memory segment.
+  /// Each writing thread owns one slot, so slots are updated without locks; a reader sums all slots.
+  /// When every slot is taken, further samples are counted as dropped rather than recorded.
+public:
+  static unsigned int constexpr default_slots{256};                             // writing threads across all attached processes, unless set by the first writer
+  static unsigned int constexpr max_sites{64};                                  // distinct named timing sites
+  static unsigned int constexpr max_site_name{48};                              // including the terminating null
+  static unsigned int constexpr histogram_sub_bucket_bits{2};
+  static unsigned int constexpr histogram_sub_buckets{1u << histogram_sub_bucket_bits}; // linear divisions of each power of two, so a bucket spans at most 25% of its lower bound
+  static unsigned int constexpr histogram_buckets{(65 - histogram_sub_bucket_bits) * histogram_sub_buckets}; // log-linear, covering every uint64_t nanosecond count
+
+  enum class access {
+    read_write,
+    read_only,
+  };
+
+  struct site_totals {
+    std::string name;
+    unsigned int site{0};                                                       // index as returned by add_site()
+    uint64_t count{0};
+    uint64_t total_ns{0};
+    uint64_t min_ns{0};
+    uint64_t max_ns{0};
+    std::array<uint64_t, histogram_buckets> histogram{};
+  };
+  struct totals {
+    unsigned int writers{0};                                                    // slots currently owned by a live process
+    unsigned int slots{0};                                                      // slots in the segment
+    uint64_t dropped{0};                                                        // samples lost because no slot was free or the site was invalid
+    std::vector<site_totals> sites;
+  };
+
+  class scope {
+    /// RAII helper recording the lifetime of the scope against a site
+    shared_stats &stats;
+    unsigned int site;
+    std::chrono::steady_clock::time_point time_start{std::chrono::steady_clock::now()};
+
+  public:
+    scope(shared_stats &this_stats, unsigned int this_site);
+    ~scope();
+  };
+
+private:
+  struct alignas(64) accumulator {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint64_t histogram[histogram_buckets];
+  };
+  struct site_entry {
+    uint64_t state;                                                             // 0 = empty, 1 = being named, 2 = ready, 3 = abandoned while being named
+    char name[max_site_name];
+  };
+  struct slot {
+    uint64_t owner;                                                             // owning instance in the high half and pid in the low half, 0 when free
+    uint64_t claimed;                                                           // set once ever owned, so readers can skip untouched slots
+    accumulator sites[max_sites];
+  };
+  struct layout {
+    uint64_t magic;
+    uint64_t version;
+    uint64_t slot_count;
+    uint64_t site_count;
+    uint64_t bucket_count;
+    uint64_t dropped;
+    site_entry site_table[max_sites];
+  };                                                                            // followed by slot_count slots
+  struct writer_entry {
+    std::weak_ptr<layout> mapping;                                              // lets thread exit tell whether the slot is still mapped
+    uint64_t instance{0};                                                       // which shared_stats object the slot belongs to, 0 when unused
+    uint64_t fork_generation{0};                                                // a forked child must not reuse its parent's slot
+    slot *owned{nullptr};                                                       // null when no slot was free
+    unsigned int retry_countdown{0};                                            // samples to drop before looking for a free slot again
+
+    void release_owned();
+  };
+  struct writer_cache {
+    /// One slot per shared_stats object this thread writes through, so alternating between objects keeps every slot
+    std::array<writer_entry, 8> entries;
+    unsigned int next_eviction{0};                                              // round robin, for when a thread writes through more objects than entries
+    ~writer_cache();
+  };
+
+  static uint64_t constexpr magic_value{0x74696d6573746f72};                    // "timestor"
+  static uint64_t constexpr version_value{3};
+  static unsigned int constexpr claim_retry_interval{1024};
+  static std::chrono::milliseconds constexpr naming_timeout{100};               // naming an entry takes microseconds, so longer means its writer died
+
+  std::string name;
+  std::shared_ptr<layout> data;
+  uint64_t instance;
+  bool writable;
+  unsigned int slot_count{0};
+
+  static std::atomic<uint64_t> &fork_generation();
+  static std::atomic<uint64_t> &instance_counter();
+  static writer_cache &cache();
+  static bool owner_alive(uint64_t owner);
+  static void release(slot &this_slot, uint64_t owner);
+  static size_t slots_offset();
+  static size_t segment_size(unsigned int slots);
+
+  uint64_t owner_tag() const;
+  std::span<slot> get_slots() const;
+  void drop();
+
+  static bool wait_until_named(std::atomic_ref<uint64_t> state);
+
+  slot *writer_slot();
+  slot *claim_slot();
+
+public:
+  shared_stats(std::string const &segment_name = "/timestorm",
+               access mode = access::read_write,
+               unsigned int slots = default_slots);
+  shared_stats(shared_stats const&) = delete;
+  shared_stats &operator=(shared_stats const&) = delete;
+  ~shared_stats();
+
+  unsigned int add_site(std::string_view site_name);
+  void record(unsigned int site, std::chrono::nanoseconds duration) noexcept;
+  totals snapshot() const;
+
+  static unsigned int histogram_bucket(uint64_t nanoseconds);
+  static uint64_t histogram_lower_bound(unsigned int bucket);
+
+  static void remove(std::string const &segment_name = "/timestorm");
+};
+
+inline void shared_stats::writer_entry::release_owned() {
+  /// Hand the slot back for reuse, unless it was inherited across a fork or its mapping is gone
+  if(owned && fork_generation == shared_stats::fork_generation().load(std::memory_order_relaxed) && mapping.lock()) {
+    release(*owned, (instance << 32) | static_cast<uint64_t>(getpid()));
+  }
+  owned = nullptr;
+}
+
+inline shared_stats::writer_cache::~writer_cache() {
+  /// Hand the slots back for reuse when the owning thread exits
+  for(auto &entry : entries) {
+    entry.release_owned();
+  }
+}
+
+inline shared_stats::scope::scope(shared_stats &this_stats, unsigned int this_site)
+  : stats{this_stats},
+    site{this_site} {
+  /// Default constructor
+}
+
+inline shared_stats::scope::~scope() {
+  /// Record the time taken on destruction
+  stats.record(site, std::chrono::steady_clock::now() - time_start);
+}
+
+inline shared_stats::shared_stats(std::string const &segment_name,
+                                  access mode,
+                                  unsigned int slots)
+  : name{segment_name},
+    instance{++instance_counter()},
+    writable{mode == access::read_write} {
+  /// Create or attach to the named segment.  The first writer sets the number of slots; later attachments use that.
+  if(slots == 0) {
+    throw std::invalid_argument("timestorm: shared memory segment " + name + " needs at least one slot");
+  }
+  fork_generation();                                                            // make sure the fork handler is registered before any slot is claimed
+  int const fd{shm_open(name.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0666)};
+  if(fd == -1) {
+    throw std::system_error(errno, std::generic_category(), "timestorm: unable to open shared memory segment " + name);
+  }
+  auto const fail{[&](int error, std::string const &what){
+    close(fd);
+    throw std::system_error(error, std::generic_category(), "timestorm: " + what + " shared memory segment " + name);
+  }};
+  auto const ensure_size{[&](size_t size){
+    struct stat info{};
+    if(fstat(fd, &info) == -1) {
+      fail(errno, "unable to stat");
+    }
+    if(static_cast<size_t>(info.st_size) < size) {
+      if(!writable) {
+        fail(EINVAL, "too small");
+      }
+      if(ftruncate(fd, static_cast<off_t>(size)) == -1) {                       // new space starts zeroed, which is a valid empty state
+        fail(errno, "unable to resize");
+      }
+    }
+  }};
+
+  ensure_size(writable ? segment_size(slots) : sizeof(layout));
+  void *header{mmap(nullptr, sizeof(layout), writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0)};
+  if(header == MAP_FAILED) {
+    fail(errno, "unable to map");
+  }
+  layout &this_header{*static_cast<layout*>(header)};
+  uint64_t stamped{0};
+  if(writable) {                                                                // the first writer stamps the dimensions
+    std::atomic_ref<uint64_t>{this_header.slot_count}.compare_exchange_strong(stamped, slots, std::memory_order_acq_rel);
+    if(stamped == 0) {
+      stamped = slots;
+      std::atomic_ref<uint64_t>{this_header.version}.store(version_value, std::memory_order_relaxed);
+      std::atomic_ref<uint64_t>{this_header.site_count}.store(max_sites, std::memory_order_relaxed);
+      std::atomic_ref<uint64_t>{this_header.bucket_count}.store(histogram_buckets, std::memory_order_relaxed);
+      std::atomic_ref<uint64_t>{this_header.magic}.store(magic_value, std::memory_order_release);
+    }
+  } else {
+    stamped = std::atomic_ref<uint64_t>{this_header.slot_count}.load(std::memory_order_acquire);
+  }
+  uint64_t const magic{std::atomic_ref<uint64_t>{this_header.magic}.load(std::memory_order_acquire)};
+  bool const compatible{magic == 0 || (magic == magic_value &&
+                                       this_header.version == version_value &&
+                                       this_header.site_count == max_sites &&
+                                       this_header.bucket_count == histogram_buckets)};
+  munmap(header, sizeof(layout));
+  if(!compatible || stamped > std::numeric_limits<unsigned int>::max()) {
+    close(fd);
+    throw std::runtime_error("timestorm: shared memory segment " + name + " has an incompatible layout");
+  }
+  slot_count = static_cast<unsigned int>(stamped);
+
+  size_t const size{segment_size(slot_count)};
+  ensure_size(size);
+  void *mapping{mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0)};
+  close(fd);
+  if(mapping == MAP_FAILED) {
+    throw std::system_error(errno, std::generic_category(), "timestorm: unable to map shared memory segment " + name);
+  }
+  data = std::shared_ptr<layout>(static_cast<layout*>(mapping), [size](layout *this_mapping){
+    munmap(this_mapping, size);
+  });
+}
+
+inline shared_stats::~shared_stats() {
+  /// Default destructor
+  if(data && writable) {
+    uint64_t const tag{owner_tag()};
+    for(auto &this_slot : get_slots()) {                                        // hand back the slots of every thread that wrote through this object
+      release(this_slot, tag);
+    }
+  }
+}
+
+inline std::atomic<uint64_t> &shared_stats::fork_generation() {
+  /// Counter bumped in every forked child, so inherited slots are never written by two processes
+  static std::atomic<uint64_t> generation{0};
+  [[maybe_unused]] static int const registered{pthread_atfork(nullptr, nullptr, []{
+    generation.fetch_add(1, std::memory_order_relaxed);
+  })};
+  return generation;
+}
+
+inline std::atomic<uint64_t> &shared_stats::instance_counter() {
+  static std::atomic<uint64_t> counter{0};
+  return counter;
+}
+
+inline shared_stats::writer_cache &shared_stats::cache() {
+  thread_local writer_cache this_cache;
+  return this_cache;
+}
+
+inline bool shared_stats::owner_alive(uint64_t owner) {
+  /// Whether the process owning a slot still exists
+  return kill(static_cast<pid_t>(owner & 0xffff'ffff), 0) == 0 || errno != ESRCH;
+}
+
+inline void shared_stats::release(slot &this_slot, uint64_t owner) {
+  /// Free a slot if it is still held by the given owner
+  std::atomic_ref<uint64_t>{this_slot.owner}.compare_exchange_strong(owner, 0, std::memory_order_acq_rel);
+}
+
+inline size_t shared_stats::slots_offset() {
+  /// Slots follow the header, aligned for their accumulators
+  return (sizeof(layout) + alignof(slot) - 1) / alignof(slot) * alignof(slot);
+}
+
+inline size_t shared_stats::segment_size(unsigned int slots) {
+  return slots_offset() + sizeof(slot) * slots;
+}
+
+inline std::span<shared_stats::slot> shared_stats::get_slots() const {
+  return {reinterpret_cast<slot*>(reinterpret_cast<char*>(data.get()) + slots_offset()), slot_count};
+}
+
+inline void shared_stats::drop() {
+  /// Count a sample that could not be recorded
+  std::atomic_ref<uint64_t>{data->dropped}.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline uint64_t shared_stats::owner_tag() const {
+  /// Tag identifying slots owned through this object in this process
+  return (instance << 32) | static_cast<uint64_t>(getpid());
+}
+
+inline shared_stats::slot *shared_stats::writer_slot() {
+  /// Return this thread's slot for this object, claiming one on first use; null while every slot is taken
+  writer_cache &this_cache{cache()};
+  uint64_t const generation{fork_generation().load(std::memory_order_relaxed)};
+  writer_entry *this_entry{nullptr};
+  for(auto &entry : this_cache.entries) {
+    if(entry.instance == instance) [[likely]] {
+      if(entry.fork_generation == generation && (entry.owned || --entry.retry_countdown != 0)) [[likely]] { // don't rescan every slot for every dropped sample
+        return entry.owned;
+      }
+      this_entry = &entry;
+      break;
+    }
+    if(!this_entry && (entry.instance == 0 || entry.mapping.expired())) {       // unused, or its object has been destroyed and its slots released
+      this_entry = &entry;
+    }
+  }
+  if(!this_entry) {                                                             // writing through more objects than there are entries, so give one up
+    this_entry = &this_cache.entries[this_cache.next_eviction];
+    this_cache.next_eviction = (this_cache.next_eviction + 1) % this_cache.entries.size();
+    this_entry->release_owned();
+  }
+  this_entry->owned = claim_slot();
+  this_entry->retry_countdown = claim_retry_interval;
+  this_entry->mapping = data;
+  this_entry->instance = instance;
+  this_entry->fork_generation = generation;
+  return this_entry->owned;
+}
+
+inline shared_stats::slot *shared_stats::claim_slot() {
+  /// Take ownership of a free slot, or one left behind by a process that has exited.
+  /// Counters are never cleared, so totals stay monotonic across changes of owner.
+  uint64_t const tag{owner_tag()};
+  for(auto &this_slot : get_slots()) {
+    std::atomic_ref<uint64_t> owner{this_slot.owner};
+    uint64_t expected{owner.load(std::memory_order_acquire)};
+    if(expected != 0 && owner_alive(expected)) {
+      continue;
+    }
+    if(owner.compare_exchange_strong(expected, tag, std::memory_order_acq_rel)) {
+      std::atomic_ref<uint64_t>{this_slot.claimed}.store(1, std::memory_order_release);
+      return &this_slot;
+    }
+  }
+  return nullptr;
+}
+
+inline unsigned int shared_stats::add_site(std::string_view site_name) {
+  /// Find or register a named site, returning its index for use with record().
+  /// A read-only attachment can only find sites that already exist.
+  site_name = site_name.substr(0, max_site_name - 1);
+  for(unsigned int site{0}; site != max_sites; ++site) {
+    site_entry &entry{data->site_table[site]};
+    std::atomic_ref<uint64_t> state{entry.state};
+    uint64_t expected{0};
+    if(!writable) {
+      uint64_t const current{state.load(std::memory_order_acquire)};
+      if(current == 0) {
+        break;                                                                  // sites are allocated in order, so the rest are empty
+      }
+      if(current != 2) {
+        continue;                                                               // can't be marked abandoned through a read-only mapping
+      }
+    } else if(state.compare_exchange_strong(expected, 1, std::memory_order_acq_rel)) {
+      std::memcpy(entry.name, site_name.data(), site_name.size());
+      entry.name[site_name.size()] = '\0';
+      state.store(2, std::memory_order_release);
+      return site;
+    }
+    if(writable && !wait_until_named(state)) {
+      continue;                                                                 // abandoned, so leave it unused
+    }
+    if(site_name == entry.name) {
+      return site;
+    }
+  }
+  if(!writable) {
+    throw std::out_of_range("timestorm: no site " + std::string(site_name) + " in read-only shared memory segment " + name);
+  }
+  throw std::length_error("timestorm: all " + std::to_string(max_sites) + " shared memory sites are in use in " + name);
+}
+
+inline bool shared_stats::wait_until_named(std::atomic_ref<uint64_t> state) {
+  /// Wait for another process to finish naming an entry.  One that dies part way through would leave the entry
+  /// being named forever, so after naming_timeout the entry is marked abandoned and skipped from then on.
+  auto const deadline{std::chrono::steady_clock::now() + naming_timeout};
+  for(uint64_t current{state.load(std::memory_order_acquire)}; current != 2; current = state.load(std::memory_order_acquire)) {
+    if(current == 3) {
+      return false;
+    }
+    if(std::chrono::steady_clock::now() > deadline) {
+      state.compare_exchange_strong(current, 3, std::memory_order_acq_rel);    // if the namer was only slow, its store of 2 still makes the entry usable
+      return state.load(std::memory_order_acquire) == 2;
+    }
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+inline void shared_stats::record(unsigned int site, std::chrono::nanoseconds duration) noexcept {
+  /// Add one duration to this thread's slot.  Only this thread writes the slot, so plain reads and atomic stores suffice.
+  if(!writable) [[unlikely]] {                                                  // the mapping is read-only, so there is nowhere to count it
+    return;
+  }
+  slot *const this_slot{site < max_sites ? writer_slot() : nullptr};
+  if(!this_slot) [[unlikely]] {
+    drop();
+    return;
+  }
+  accumulator &acc{this_slot->sites[site]};
+  uint64_t const nanoseconds{static_cast<uint64_t>(std::max(duration.count(), decltype(duration.count()){0}))};
+  unsigned int const bucket{histogram_bucket(nanoseconds)};
+  uint64_t const count{acc.count};
+  if(count == 0 || nanoseconds < acc.min_ns) {
+    std::atomic_ref<uint64_t>{acc.min_ns}.store(nanoseconds, std::memory_order_relaxed);
+  }
+  if(nanoseconds > acc.max_ns) {
+    std::atomic_ref<uint64_t>{acc.max_ns}.store(nanoseconds, std::memory_order_relaxed);
+  }
+  std::atomic_ref<uint64_t>{acc.histogram[bucket]}.store(acc.histogram[bucket] + 1, std::memory_order_relaxed);
+  std::atomic_ref<uint64_t>{acc.total_ns}.store(acc.total_ns + nanoseconds, std::memory_order_relaxed);
+  std::atomic_ref<uint64_t>{acc.count}.store(count + 1, std::memory_order_release);
+}
+
+inline shared_stats::totals shared_stats::snapshot() const {
+  /// Sum every slot into per-site totals.  Values are read while writers run, so fields may be a few samples apart.
+  totals result;
+  result.slots = slot_count;
+  result.dropped = std::atomic_ref<uint64_t>{data->dropped}.load(std::memory_order_relaxed);
+  for(auto &this_slot : get_slots()) {
+    uint64_t const owner{std::atomic_ref<uint64_t>{this_slot.owner}.load(std::memory_order_acquire)};
+    if(owner != 0 && owner_alive(owner)) {
+      ++result.writers;
+    }
+  }
+  for(unsigned int site{0}; site != max_sites; ++site) {
+    site_entry &entry{data->site_table[site]};
+    uint64_t const state{std::atomic_ref<uint64_t>{entry.state}.load(std::memory_order_acquire)};
+    if(state == 0) {
+      break;                                                                    // sites are allocated in order, so the rest are empty
+    }
+    if(state != 2) {
+      continue;                                                                 // still being named, or abandoned
+    }
+    site_totals &sum{result.sites.emplace_back()};
+    sum.name = entry.name;
+    sum.site = site;
+    for(auto &this_slot : get_slots()) {
+      if(std::atomic_ref<uint64_t>{this_slot.claimed}.load(std::memory_order_acquire) == 0) {
+        continue;                                                               // never written, so don't fault its pages in
+      }
+      accumulator &acc{this_slot.sites[site]};
+      uint64_t const count{std::atomic_ref<uint64_t>{acc.count}.load(std::memory_order_acquire)};
+      if(count == 0) {
+        continue;
+      }
+      uint64_t const min_ns{std::atomic_ref<uint64_t>{acc.min_ns}.load(std::memory_order_relaxed)};
+      uint64_t const max_ns{std::atomic_ref<uint64_t>{acc.max_ns}.load(std::memory_order_relaxed)};
+      sum.min_ns = sum.count == 0 ? min_ns : std::min(sum.min_ns, min_ns);
+      sum.max_ns = std::max(sum.max_ns, max_ns);
+      sum.count += count;
+      sum.total_ns += std::atomic_ref<uint64_t>{acc.total_ns}.load(std::memory_order_relaxed);
+      for(unsigned int bucket{0}; bucket != histogram_buckets; ++bucket) {
+        sum.histogram[bucket] += std::atomic_ref<uint64_t>{acc.histogram[bucket]}.load(std::memory_order_relaxed);
+      }
+    }
+  }
+  return result;
+}
+
+inline unsigned int shared_stats::histogram_bucket(uint64_t nanoseconds) {
+  /// Histogram bucket for a duration: values below histogram_sub_buckets have their own buckets, then each power of two
+  /// is split into histogram_sub_buckets equal parts by the bits below the leading one
+  unsigned int const width{static_cast<unsigned int>(std::bit_width(nanoseconds))};
+  if(width <= histogram_sub_bucket_bits) {
+    return static_cast<unsigned int>(nanoseconds);
+  }
+  return (width - histogram_sub_bucket_bits) * histogram_sub_buckets +
+         static_cast<unsigned int>((nanoseconds >> (width - 1 - histogram_sub_bucket_bits)) & (histogram_sub_buckets - 1));
+}
+
+inline uint64_t shared_stats::histogram_lower_bound(unsigned int bucket) {
+  /// Smallest duration in nanoseconds that falls in a bucket; the bucket ends where the next one begins
+  if(bucket < histogram_sub_buckets) {
+    return bucket;
+  }
+  return uint64_t{histogram_sub_buckets + bucket % histogram_sub_buckets} << (bucket / histogram_sub_buckets - 1);
+}
+
+inline void shared_stats::remove(std::string const &segment_name) {
+  /// Unlink the named segment; processes already attached keep their mapping
+  shm_unlink(segment_name.c_str());
+}
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+namespace timestorm {
+
+class span_context {
+  /// Identifies the request a timed scope works on, so its cost can be summed across threads.
+  /// Timers record into the span current on their thread when they were constructed; to carry a span
+  /// onto a thread pool, capture it with bind_span() when submitting the task.
+  /// Only a pointer is passed around, so the span must outlive every task it is handed to.
+  /// The total is a sum of timed scopes, not wall time: a timer nested inside another timer on the same span
+  /// is counted by both, and a child span's scopes count again in every ancestor.  To leave a nested timer
+  /// out, set its span to nullptr.
+  std::atomic<int64_t> total_ns{0};
+  std::atomic<uint64_t> scopes{0};
+
+  static uint64_t next_span_id();
+
+public:
+  uint64_t const request_id;
+  uint64_t const span_id{next_span_id()};
+  uint64_t const parent_id;                                                     // span_id of the parent span, 0 for a root
+  span_context *const parent;
+
+  explicit span_context(uint64_t new_request_id);
+  explicit span_context(span_context &new_parent);
+  span_context(span_context const&) = delete;
+  span_context &operator=(span_context const&) = delete;
+
+  void record(std::chrono::nanoseconds duration);
+  std::chrono::nanoseconds get_total_duration() const;
+  uint64_t get_scope_count() const;
+};
+
+namespace detail {
+inline thread_local span_context *current_span{nullptr};
+}
+
+inline span_context *current_span() {
+  /// The span timed scopes on this thread are recorded against, if any
+  return detail::current_span;
+}
+
+class span_scope {
+  /// RAII helper making a span current on this thread, restoring the previous one on destruction
+  span_context *const previous;
+
+public:
+  explicit span_scope(span_context *span);
+  span_scope(span_scope const&) = delete;
+  span_scope &operator=(span_scope const&) = delete;
+  ~span_scope();
+};
+
+template<typename function_t>
+auto bind_span(function_t &&function) {
+  /// Wrap a task so that it runs with the submitting thread's current span
+  return [span = current_span(), function = std::forward<function_t>(function)](auto &&...args) mutable -> decltype(auto) {
+    span_scope const scope(span);
+    return function(std::forward<decltype(args)>(args)...);
+  };
+}
+
+inline uint64_t span_context::next_span_id() {
+  static std::atomic<uint64_t> counter{0};
+  return ++counter;
+}
+
+inline span_context::span_context(uint64_t new_request_id)
+  : request_id{new_request_id},
+    parent_id{0},
+    parent{nullptr} {
+  /// Root span constructor
+}
+
+inline span_context::span_context(span_context &new_parent)
+  : request_id{new_parent.request_id},
+    parent_id{new_parent.span_id},
+    parent{&new_parent} {
+  /// Child span constructor; time recorded here is also added to every ancestor
+}
+
+inline void span_context::record(std::chrono::nanoseconds duration) {
+  /// Add the duration of one timed scope to this span and its ancestors
+  for(span_context *span{this}; span; span = span->parent) {
+    span->total_ns.fetch_add(duration.count(), std::memory_order_relaxed);
+    span->scopes.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+inline std::chrono::nanoseconds span_context::get_total_duration() const {
+  /// Sum of every scope recorded here or in a child span; overlapping scopes each count in full
+  return std::chrono::nanoseconds{total_ns.load(std::memory_order_relaxed)};
+}
+
+inline uint64_t span_context::get_scope_count() const {
+  return scopes.load(std::memory_order_relaxed);
+}
+
+inline span_scope::span_scope(span_context *span)
+  : previous{detail::current_span} {
+  /// Default constructor
+  detail::current_span = span;
+}
+
+inline span_scope::~span_scope() {
+  /// Default destructor
+  detail::current_span = previous;
+}
+
+}
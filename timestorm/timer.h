@@ -8,9 +8,11 @@
 #include <iostream>
 #include <string>
 #include <type_traits>
+#include "span_context.h"
 #include "timescale.h"
 
 //#define TIMESTORM_NO_UNICODE
+//#define TIMESTORM_EXTERN_TEMPLATES
 
 namespace timestorm {
 
@@ -33,6 +35,7 @@ public:
   std::function<std::string()> prefix;                                          // what to run to generate output when finished before the time value
   std::function<std::string()> suffix;                                          // what to run to generate output when finished after the time value
   timescale scale{timescale::AUTO};                                             // on what timescale to report the results
+  span_context *span{current_span()};                                           // which request the time taken is recorded against, if any
 
   timer(timescale new_scale = timescale::AUTO,
         std::string const &message_pre  = "Done in ",
@@ -67,6 +70,11 @@ public:
 
   void set_prefix(std::string const &new_prefix);
   void set_suffix(std::string const &new_suffix);
+
+private:
+  std::chrono::steady_clock::time_point span_start{span ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{}}; // monotonic, as system_clock may jump; only read when a span is current
+
+  std::chrono::nanoseconds get_span_duration() const;
 };
 
 template<typename T, typename sink_t>
@@ -158,7 +166,11 @@ timer<T, sink_t>::timer(streamlike auto &this_sink,
 template<typename T, typename sink_t>
 timer<T, sink_t>::~timer() {
   /// Default destructor
+  auto const span_duration{span ? get_span_duration() : std::chrono::nanoseconds{0}}; // read before output, so the span isn't charged for it
   output();                                                                     // output the time on destruction
+  if(span) {
+    span->record(span_duration);
+  }
 }
 
 template<typename T, typename sink_t>
@@ -174,128 +186,35 @@ template<typename T, typename sink_t>
 void timer<T, sink_t>::reset() {
   /// Reset the timer to zero
   time_start = std::chrono::system_clock::now();
+  span_start = span ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
 }
 
 template<typename T, typename sink_t>
 T const timer<T, sink_t>::get_time() {
-  /// Return a value containing the type in whatever format is desired
-  switch(scale) {
-  case timescale::DAYS:
-  case timescale::AUTO:
-    {
-      T const nanoseconds{static_cast<T>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now() - time_start).count())};
-      int64_t constexpr trillion{int64_t{1'000'000} * int64_t{1'000'000}};      // this is a hack - see http://stackoverflow.com/questions/33644412/how-to-silence-long-long-integer-constant-warning-from-gcc
-      if(nanoseconds < 1000) {
-        scale = timescale::NANOSECONDS;
-        return nanoseconds;
-      } else if(nanoseconds < 1'000'000) {
-        scale = timescale::MICROSECONDS;
-        return nanoseconds / static_cast<T>(1'000);
-      } else if(nanoseconds < 1'000'000'000) {
-        scale = timescale::MILLISECONDS;
-        return nanoseconds / static_cast<T>(1'000'000);
-      } else if(static_cast<int64_t>(nanoseconds) < trillion) {
-        scale = timescale::SECONDS;
-        return nanoseconds / static_cast<T>(1'000'000'000);
-      } else {
-        T const seconds{static_cast<T>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now() - time_start).count())};
-        if(seconds < 60) {
-          scale = timescale::SECONDS;
-          return seconds;
-        } else if(seconds < 60 * 60) {
-          scale = timescale::MINUTES;
-          return seconds / static_cast<T>(60);
-        } else if(seconds < 60 * 60 * 24) {
-          scale = timescale::HOURS;
-          return seconds / static_cast<T>(60 * 60);
-        } else {
-          scale = timescale::DAYS;
-          return seconds / static_cast<T>(60 * 60 * 24);
-        }
-      }
-    }
-    [[fallthrough]];
-  case timescale::NANOSECONDS:
-    return static_cast<T>(std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::system_clock::now() - time_start).count());
-  case timescale::MICROSECONDS:
-    //return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - time_start).count();
-    return static_cast<T>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now() - time_start).count()) / static_cast<T>(1'000);
-  case timescale::MILLISECONDS:
-    //return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - time_start).count();
-    return static_cast<T>(std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::system_clock::now() - time_start).count()) / static_cast<T>(1'000'000);
-  case timescale::SECONDS:
-    //return std::chrono::duration_cast<std::chrono::seconds>(     std::chrono::system_clock::now() - time_start).count();
-    //return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::system_clock::now() - time_start).count() / 1'000'000;
-    //return static_cast<T>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - time_start).count()) * std::chrono::milliseconds::period::num / std::chrono::milliseconds::period::den;
-    return static_cast<T>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now() - time_start).count()) / static_cast<T>(1'000'000'000);
-  case timescale::MINUTES:
-    //return std::chrono::duration_cast<std::chrono::minutes>(     std::chrono::system_clock::now() - time_start).count();
-    //return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::system_clock::now() - time_start).count() / (1'000'000 * 60);
-    return static_cast<T>(std::chrono::duration_cast<std::chrono::seconds>( std::chrono::system_clock::now() - time_start).count()) / static_cast<T>(60);
-  case timescale::HOURS:
-    //return std::chrono::duration_cast<std::chrono::hours>(       std::chrono::system_clock::now() - time_start).count();
-    //return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::system_clock::now() - time_start).count() / (1'000'000 * 60 * 60);
-    return static_cast<T>(std::chrono::duration_cast<std::chrono::minutes>( std::chrono::system_clock::now() - time_start).count()) / static_cast<T>(60);
+  /// Return a value containing the type in whatever format is desired; AUTO settles on a scale from the time so far
+  auto const duration{std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now() - time_start)};
+  if(scale == timescale::AUTO) {
+    scale = auto_timescale(duration);
   }
-  return {};                                                                    // not actually reachable
+  return scale_duration<T>(duration, scale);
 }
 
 template<typename T, typename sink_t>
 std::string const timer<T, sink_t>::get_unit() {
-  switch(scale) {
-  case timescale::DAYS:
-  case timescale::AUTO:
-    {
-      T const nanoseconds{static_cast<T>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now() - time_start).count())};
-      int64_t constexpr trillion{int64_t{1'000'000} * int64_t{1'000'000}};      // this is a hack - see http://stackoverflow.com/questions/33644412/how-to-silence-long-long-integer-constant-warning-from-gcc
-      if(nanoseconds < 1000) {
-        scale = timescale::NANOSECONDS;
-        return get_unit();
-      } else if(nanoseconds < 1'000'000) {
-        scale = timescale::MICROSECONDS;
-        return get_unit();
-      } else if(nanoseconds < 1'000'000'000) {
-        scale = timescale::MILLISECONDS;
-        return get_unit();
-      } else if(static_cast<int64_t>(nanoseconds) < trillion) {
-        scale = timescale::SECONDS;
-        return get_unit();
-      } else {
-        T const seconds{static_cast<T>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now() - time_start).count())};
-        if(seconds < 60) {
-          scale = timescale::SECONDS;
-          return get_unit();
-        } else if(seconds < 60 * 60) {
-          scale = timescale::MINUTES;
-          return get_unit();
-        } else if(seconds < 60 * 60 * 24) {
-          scale = timescale::HOURS;
-          return get_unit();
-        } else {
-          scale = timescale::DAYS;
-          return get_unit();
-        }
-      }
-    }
-    [[fallthrough]];
-  case timescale::NANOSECONDS:
-    return "ns";
-  case timescale::MICROSECONDS:
-    #ifdef TIMESTORM_NO_UNICODE
-      return "us";
-    #else
-      return "μs";
-    #endif // TIMESTORM_NO_UNICODE
-  case timescale::MILLISECONDS:
-    return "ms";
-  case timescale::SECONDS:
-    return "s";
-  case timescale::MINUTES:
-    return "m";
-  case timescale::HOURS:
-    return "h";
+  if(scale == timescale::AUTO) {
+    scale = auto_timescale(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now() - time_start));
+  }
+  return timescale_unit(scale);
+}
+
+template<typename T, typename sink_t>
+std::chrono::nanoseconds timer<T, sink_t>::get_span_duration() const {
+  /// Time to record against the span.  If the span was set after construction there is no monotonic start,
+  /// so fall back to time_start.
+  if(span_start == std::chrono::steady_clock::time_point{}) [[unlikely]] {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now() - time_start);
   }
-  return {};                                                                    // not actually reachable
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - span_start);
 }
 
 template<typename T, typename sink_t>
@@ -307,4 +226,13 @@ void timer<T, sink_t>::set_suffix(std::string const &new_suffix) {
   suffix = [new_suffix]{return new_suffix;};
 }
 
+#ifdef TIMESTORM_EXTERN_TEMPLATES
+// instantiated once in timer.cpp, so translation units including this header don't each instantiate them;
+// opt-in, as only code linking the timestorm library has them - the timestorm::timestorm target defines it
+extern template class timer<float, std::ostream>;
+extern template class timer<double, std::ostream>;
+extern template class timer<int, std::ostream>;
+extern template class timer<unsigned int, std::ostream>;
+#endif // TIMESTORM_EXTERN_TEMPLATES
+
 }
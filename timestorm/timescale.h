@@ -1,5 +1,8 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+
 namespace timestorm {
 
 enum class timescale {
@@ -13,4 +16,76 @@ enum class timescale {
   DAYS,
 };
 
+inline timescale auto_timescale(std::chrono::nanoseconds duration) {
+  /// Choose the most readable timescale for a duration, as timescale::AUTO does.
+  /// Seconds are kept up to 1000s, as timer always has, before switching to minutes.
+  int64_t const nanoseconds{duration.count()};
+  if(nanoseconds < 1'000) {
+    return timescale::NANOSECONDS;
+  } else if(nanoseconds < 1'000'000) {
+    return timescale::MICROSECONDS;
+  } else if(nanoseconds < 1'000'000'000) {
+    return timescale::MILLISECONDS;
+  } else if(nanoseconds < int64_t{1'000} * 1'000'000'000) {
+    return timescale::SECONDS;
+  } else if(nanoseconds < int64_t{60 * 60} * 1'000'000'000) {
+    return timescale::MINUTES;
+  } else if(nanoseconds < int64_t{60 * 60 * 24} * 1'000'000'000) {
+    return timescale::HOURS;
+  }
+  return timescale::DAYS;
+}
+
+template<typename T>
+T scale_duration(std::chrono::nanoseconds duration, timescale scale) {
+  /// Express a duration as a count of the given timescale's units
+  T const nanoseconds{static_cast<T>(duration.count())};
+  switch(scale) {
+  case timescale::AUTO:
+    return scale_duration<T>(duration, auto_timescale(duration));
+  case timescale::NANOSECONDS:
+    return nanoseconds;
+  case timescale::MICROSECONDS:
+    return nanoseconds / static_cast<T>(1'000);
+  case timescale::MILLISECONDS:
+    return nanoseconds / static_cast<T>(1'000'000);
+  case timescale::SECONDS:
+    return nanoseconds / static_cast<T>(1'000'000'000);
+  case timescale::MINUTES:
+    return static_cast<T>(std::chrono::duration_cast<std::chrono::seconds>(duration).count()) / static_cast<T>(60);
+  case timescale::HOURS:
+    return static_cast<T>(std::chrono::duration_cast<std::chrono::seconds>(duration).count()) / static_cast<T>(60 * 60);
+  case timescale::DAYS:
+    return static_cast<T>(std::chrono::duration_cast<std::chrono::seconds>(duration).count()) / static_cast<T>(60 * 60 * 24);
+  }
+  return {};                                                                    // not actually reachable
+}
+
+inline char const *timescale_unit(timescale scale) {
+  /// Unit suffix for a timescale; AUTO has no unit of its own
+  switch(scale) {
+  case timescale::AUTO:
+    return "";
+  case timescale::NANOSECONDS:
+    return "ns";
+  case timescale::MICROSECONDS:
+    #ifdef TIMESTORM_NO_UNICODE
+      return "us";
+    #else
+      return "μs";
+    #endif // TIMESTORM_NO_UNICODE
+  case timescale::MILLISECONDS:
+    return "ms";
+  case timescale::SECONDS:
+    return "s";
+  case timescale::MINUTES:
+    return "m";
+  case timescale::HOURS:
+    return "h";
+  case timescale::DAYS:
+    return "d";
+  }
+  return "";                                                                    // not actually reachable
+}
+
 }
@@ -0,0 +1,41 @@
+module;
+
+// C++20 module interface, built when configured with -DTIMESTORM_BUILD_MODULE=ON:
+//   import timestorm;
+// The headers are included in the global module fragment and their public names re-exported.
+
+#include "timestorm.h"
+#include "coroutine_timer.h"
+#include "sample_recorder.h"
+#if __has_include(<sys/mman.h>)
+  #include "shared_stats.h"
+#endif
+
+export module timestorm;
+
+export namespace timestorm {
+
+using timestorm::timescale;
+using timestorm::auto_timescale;
+using timestorm::scale_duration;
+using timestorm::timescale_unit;
+
+using timestorm::default_timer_type;
+using timestorm::streamlike;
+using timestorm::timer;
+using timestorm::phase_timer;
+using timestorm::coroutine_timer;
+
+using timestorm::span_context;
+using timestorm::span_scope;
+using timestorm::current_span;
+using timestorm::bind_span;
+
+using timestorm::sample_stats;
+using timestorm::sample_recorder;
+
+#if __has_include(<sys/mman.h>)
+using timestorm::shared_stats;
+#endif
+
+}
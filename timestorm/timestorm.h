@@ -1,4 +1,6 @@
 #pragma once
 
 #include "timescale.h"
+#include "span_context.h"
 #include "timer.h"
+#include "phase_timer.h"
@@ -2,7 +2,10 @@
 
 namespace timestorm {
 
-template<typename T> class timer;
+template<typename T, typename sink_t> class timer;
+template<typename T, typename sink_t, unsigned int max_phases> class phase_timer;
+template<typename T, typename sink_t> class coroutine_timer;
+class span_context;
 enum class timescale;
 
 }
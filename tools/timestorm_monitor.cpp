@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "timestorm/shared_stats.h"
+
+// Live view of a timestorm::shared_stats segment: rates and latencies summed
+// across every attached process, redrawn in place each interval.
+//
+// Usage: timestorm_monitor [segment name] [interval in milliseconds]
+
+namespace {
+
+std::string format_duration(double nanoseconds) {
+  /// Scale a duration to the most readable unit, as timescale::AUTO does
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(1);
+  if(nanoseconds < 1'000.0) {
+    out << nanoseconds << "ns";
+  } else if(nanoseconds < 1'000'000.0) {
+    #ifdef TIMESTORM_NO_UNICODE
+      out << nanoseconds / 1'000.0 << "us";
+    #else
+      out << nanoseconds / 1'000.0 << "μs";
+    #endif // TIMESTORM_NO_UNICODE
+  } else if(nanoseconds < 1'000'000'000.0) {
+    out << nanoseconds / 1'000'000.0 << "ms";
+  } else if(nanoseconds < 60'000'000'000.0) {
+    out << nanoseconds / 1'000'000'000.0 << "s";
+  } else {
+    out << nanoseconds / 60'000'000'000.0 << "m";
+  }
+  return out.str();
+}
+
+double percentile(std::array<uint64_t, timestorm::shared_stats::histogram_buckets> const &histogram,
+                  uint64_t count,
+                  double fraction,
+                  timestorm::shared_stats::site_totals const &site) {
+  /// Estimate a percentile by linear interpolation within the histogram bucket holding it.
+  /// Buckets span at most a quarter of their lower bound, which bounds the error, and the site's
+  /// all-time minimum and maximum narrow it further, since every sample in the interval lies between them.
+  auto const bounded{[&site](double estimate){
+    return std::clamp(estimate, static_cast<double>(site.min_ns), static_cast<double>(site.max_ns));
+  }};
+  double const target{static_cast<double>(count) * fraction};
+  uint64_t seen{0};
+  double upper{0.0};
+  for(unsigned int bucket{0}; bucket != histogram.size(); ++bucket) {
+    if(histogram[bucket] == 0) {
+      continue;
+    }
+    double const lower{static_cast<double>(timestorm::shared_stats::histogram_lower_bound(bucket))};
+    upper = bucket + 1 == histogram.size() ? std::ldexp(1.0, 64) : static_cast<double>(timestorm::shared_stats::histogram_lower_bound(bucket + 1));
+    if(static_cast<double>(seen + histogram[bucket]) > target) {
+      double const within{(target - static_cast<double>(seen)) / static_cast<double>(histogram[bucket])};
+      return bounded(lower + (upper - lower) * within);
+    }
+    seen += histogram[bucket];
+  }
+  return bounded(upper);                                                        // the fraction is 1, so the top of the highest bucket in use
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  std::string const segment_name{argc > 1 ? argv[1] : "/timestorm"};
+  std::chrono::milliseconds const interval{argc > 2 ? std::atoi(argv[2]) : 1000};
+
+  try {
+    timestorm::shared_stats const stats(segment_name, timestorm::shared_stats::access::read_only);
+
+    std::map<std::string, timestorm::shared_stats::site_totals> previous;
+    for(auto const &site : stats.snapshot().sites) {                            // baseline, so the first interval shows only its own calls
+      previous[site.name] = site;
+    }
+    auto time_previous{std::chrono::steady_clock::now()};
+    for(;;) {
+      std::this_thread::sleep_for(interval);
+      auto const totals{stats.snapshot()};
+      auto const time_now{std::chrono::steady_clock::now()};
+      double const seconds{std::chrono::duration<double>(time_now - time_previous).count()};
+      time_previous = time_now;
+
+      std::ostringstream screen;
+      screen << "\x1b[H\x1b[2J";                                                // home the cursor and clear, so the table redraws in place
+      screen << "timestorm " << segment_name << " - " << totals.writers << " of " << totals.slots << " slots in use, "
+             << totals.dropped << " samples dropped\n\n";
+      screen << std::left << std::setw(32) << "site"
+             << std::right << std::setw(12) << "calls/s"
+             << std::setw(12) << "mean"
+             << std::setw(12) << "p50"
+             << std::setw(12) << "p99"
+             << std::setw(12) << "max (all)"                                    // the segment keeps only an all-time maximum
+             << std::setw(14) << "total calls" << '\n';
+      for(auto const &site : totals.sites) {
+        auto const &last{previous[site.name]};
+        uint64_t const count{site.count - last.count};                          // slot counters are monotonic, so differences are never negative
+        uint64_t const total_ns{site.total_ns - last.total_ns};
+        std::array<uint64_t, timestorm::shared_stats::histogram_buckets> histogram{};
+        for(unsigned int bucket{0}; bucket != histogram.size(); ++bucket) {
+          histogram[bucket] = site.histogram[bucket] - last.histogram[bucket];
+        }
+        screen << std::left << std::setw(32) << site.name << std::right
+               << std::setw(12) << std::fixed << std::setprecision(1) << static_cast<double>(count) / seconds;
+        if(count == 0) {
+          screen << std::setw(12) << "-" << std::setw(12) << "-" << std::setw(12) << "-";
+        } else {
+          screen << std::setw(12) << format_duration(static_cast<double>(total_ns) / static_cast<double>(count))
+                 << std::setw(12) << format_duration(percentile(histogram, count, 0.50, site))
+                 << std::setw(12) << format_duration(percentile(histogram, count, 0.99, site));
+        }
+        screen << std::setw(12) << format_duration(static_cast<double>(site.max_ns))
+               << std::setw(14) << site.count << '\n';
+        previous[site.name] = site;
+      }
+      std::cout << screen.str() << std::flush;
+    }
+  } catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}